@@ -0,0 +1,43 @@
+/*
+ * decomposition of agents into independent groups
+ *
+ * The corridor of an agent is the set of vertices on its shortest paths,
+ * i.e., vertices reachable from its start by moves that decrease the
+ * distance to its goal. Agents whose corridors, dilated by MARGIN steps,
+ * share no vertex are put into different groups, and each group is solved
+ * alone, on the graph and the distance table of the whole instance. Agents
+ * may still leave their corridors to make way for others, so the merged
+ * plan is checked and the caller falls back to a joint solve when groups
+ * collide.
+ */
+#pragma once
+
+#include "dist_table.hpp"
+#include "instance.hpp"
+#include "lacam.hpp"
+#include "post_processing.hpp"
+#include "utils.hpp"
+
+struct Decomposition {
+  const Instance *ins;
+  DistTable *D;
+  std::vector<std::vector<int>> groups;  // agents in ascending order
+  std::vector<int> mark;  // visited stamps per vertex, for get_region
+  int stamp;
+
+  // Hyperparameters
+  static bool ENABLED;
+  static int MARGIN;       // dilation of corridors in steps
+  static int NUM_THREADS;  // groups solved concurrently
+
+  Decomposition(const Instance *_ins, DistTable *_D);
+
+  // vertex ids of the corridor of agent-i dilated by MARGIN
+  std::vector<int> get_region(const int i);
+  // each group by LaCAM; empty -> a single group, a group failed, or plans
+  // of groups collide
+  Solution solve(const int verbose, const Deadline *deadline, int seed,
+                 MemoryBudget *budget = nullptr);
+  // configurations of ins, shorter plans wait at their goals
+  Solution merge(const std::vector<Solution> &solutions) const;
+};
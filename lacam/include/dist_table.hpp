@@ -12,14 +12,30 @@ struct DistTable {
   std::vector<std::vector<int>>
       table;  // distance table, index: agent-id & vertex-id
   std::vector<std::queue<Vertex *>> OPEN;  // search queue
+  DistTable *base;           // nullptr, or the owner of the rows
+  std::vector<int> agents;   // rows taken from base
 
   static bool MULTI_THREAD_INIT;
 
   int get(const int i, const int v_id);   // agent, vertex-id
   int get(const int i, const Vertex *v);  // agent, vertex
 
-  DistTable(const Instance &ins);
-  DistTable(const Instance *ins);
+  // deadline: the multi-thread initialization stops when it expires and
+  // the remaining distances are evaluated lazily;
+  // multi_thread: false -> lazy BFS, e.g., many small tables on a pool
+  DistTable(const Instance &ins, const Deadline *deadline = nullptr,
+            const bool multi_thread = MULTI_THREAD_INIT);
+  DistTable(const Instance *ins, const Deadline *deadline = nullptr,
+            const bool multi_thread = MULTI_THREAD_INIT);
+  // rows of _agents taken from _base without copies, and given back on
+  // destruction, e.g., for a sub-instance of these agents; tables of
+  // disjoint agents can be used concurrently even while lazy
+  DistTable(DistTable &_base, const std::vector<int> &_agents);
+  DistTable(const DistTable &) = delete;
+  ~DistTable();
 
-  void setup(const Instance *ins);  // initialization
+  // initialization
+  void setup(const Instance *ins, const Deadline *deadline,
+             const bool multi_thread);
+  size_t memory_usage() const;      // approximate, bytes
 };
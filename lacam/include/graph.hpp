@@ -28,8 +28,15 @@ struct Graph {
   Vertices U;  // with nullptr, i.e., |U| = width * height
   int width;   // grid width
   int height;  // grid height
+  bool owner;  // false -> the vertices belong to another graph
   Graph(int w = 0, int h = 0);
   Graph(const std::string &filename);  // taking map filename
+  Graph(const Graph &G);  // deep copy, the same ids and neighbor order
+  // shallow copy sharing the vertices of G, which has to outlive this one
+  Graph(const Graph *G);
+  // subgraph induced by vertex_ids, V[k] corresponds to G.V[vertex_ids[k]];
+  // coordinates are relative to the bounding box of the subgraph
+  Graph(const Graph &G, const std::vector<int> &vertex_ids);
   ~Graph();
 
   int size() const;  // the number of vertices, |V|
@@ -55,6 +62,13 @@ struct ConfigHasher {
   uint operator()(const Config &C) const;
 };
 
+// 64-bit hash of configuration, XOR of per-agent terms;
+// updated in O(1) per moved agent, see HNode
+uint64_t get_agent_hash(const int i, const Vertex *v);
+uint64_t get_config_hash(const Config &C);
+uint64_t get_config_hash(uint64_t hash_from, const Config &C_from,
+                         const Config &C_to);
+
 std::ostream &operator<<(std::ostream &os, const Vertex *v);
 std::ostream &operator<<(std::ostream &os, const Config &Q);
 std::ostream &operator<<(std::ostream &os, const Paths &paths);
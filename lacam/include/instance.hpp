@@ -22,6 +22,12 @@ struct Instance {
   // random instance generation
   Instance(const std::string &map_filename, const int _N = 1,
            const int seed = 0);
+  // agents of ins, on the vertices of its graph; ins has to outlive this
+  Instance(const Instance &ins, const std::vector<int> &agents);
+  // on the subgraph of _G induced by vertex_ids; starts and goals are
+  // positions in vertex_ids
+  Instance(const Graph &_G, const std::vector<int> &vertex_ids,
+           const std::vector<int> &start_ids, const std::vector<int> &goal_ids);
   ~Instance();
 
   // simple feasibility check of instance
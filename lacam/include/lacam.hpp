@@ -20,29 +20,90 @@
 #include "graph.hpp"
 #include "instance.hpp"
 #include "pibt.hpp"
+#include "pibt_rollout.hpp"
+#include "spill.hpp"
 #include "utils.hpp"
 
 
-// low-level search node
+// low-level search node, i.e., one constraint "who is at where";
+// the rest is inherited through the parent link, O(1) memory per node
 struct LNode {
-  std::vector<int> who;
-  Vertices where;
+  const int parent;  // index in the search tree, -1 -> root
+  const int who;
+  Vertex *const where;
   const uint depth;
+  // children, fixed when the node is popped from the search tree
+  uint8_t num_children;
+  std::array<uint8_t, 5> perm;  // randomized order of actions
   LNode();
-  LNode(LNode *parent, int i, Vertex *v);  // who and where
+  LNode(int _parent, uint _depth, int i, Vertex *v);  // who and where
   ~LNode();
 };
 
+// notified when a solution is found or its cost (g) decreases;
+// called from the solver thread(s), keep it short
+using ImproveCallback = std::function<void(const Solution &, const int)>;
+
+// best solution so far, shared between a solver and its consumers
+struct SolutionHandle {
+  mutable std::mutex mtx;
+  std::condition_variable cv;
+  Solution solution;
+  int cost;     // -1 -> no solution yet
+  int version;  // incremented at each update
+
+  SolutionHandle();
+  void update(const Solution &_solution, const int _cost);
+  // copy the solution and return its version
+  int get(Solution &_solution) const;
+  int get_cost() const;
+  // wait until the version exceeds known_version or the timeout passes
+  int wait(const int known_version, const double timeout_ms);
+  ImproveCallback get_callback();  // update this handle
+};
+
 struct HNode;
 struct CompareHNodePointers {  // for determinism
   bool operator()(const HNode *lhs, const HNode *rhs) const;
 };
 
+// expansion state of a high-level node, kept only while the node is open
+struct HNodeExpansion {
+  std::vector<Priority> priorities;
+  // agents not at their goals come first, sorted by priorities;
+  // the rest (settled agents) is appended only when the low-level search
+  // reaches them, see HNode::complete_order()
+  std::vector<int> order;
+  int num_active;
+  // low-level search tree, LNodes are generated on demand in BFS order;
+  // the cursor points to the next child (node index, action index)
+  std::vector<LNode> search_tree;
+  size_t cursor_node;
+  int cursor_action;  // -1 -> the root is not popped yet
+  bool exhausted;
+  int num_in_flight;  // constraints in use by other threads, parallel only
+
+  HNodeExpansion(const std::vector<Priority> &_priorities);
+  size_t memory_usage() const;  // approximate, bytes
+};
+
 // high-level search node
 struct HNode {
-  const Config Q; // locations for all agents
+  // configuration, i.e., locations for all agents;
+  // stored fully or as moves from the creating parent, see ConfigCache
+  uint64_t hash;            // get_config_hash(configuration)
+  HNode *const delta_base;  // nullptr -> stored fully in Q or spill_file
+  Config Q;                 // empty for delta-encoded or spilled nodes
+  // moves from delta_base, either (agent << 3 | action index) of moved
+  // agents, or 4-bit action indices of all agents when that is smaller
+  std::vector<uint32_t> Q_diff;
+  bool diff_dense;
+  const int delta_len;  // levels to the nearest fully stored configuration
+  const SpillFile *spill_file;  // nullptr -> not spilled
+  uint64_t spill_offset;
   HNode *parent;
-  std::set<HNode *, CompareHNodePointers> neighbors;
+  int open_index;  // position in OpenList, -1 -> not in OPEN
+  std::set<HNode *, CompareHNodePointers> neighbors;  // anytime only
 
   // cost
   int g;
@@ -50,45 +111,191 @@ struct HNode {
   int f;
   int depth;
 
-  std::vector<float> priorities;
-  std::vector<int> order;
-  std::queue<LNode *> search_tree;
+  // nullptr -> the low-level search is exhausted and the state is released;
+  // the node is then only used for duplicate detection and backtracking
+  std::unique_ptr<HNodeExpansion> expansion;
+
+  // 1 -> all configurations are stored fully, k -> delta encoding with
+  // a full configuration every k levels
+  static int FULL_CONFIG_INTERVAL;
 
-  HNode(Config _C, DistTable *D, HNode *_parent = nullptr, int _g = 0,
-        int _h = 0);
+  // activated: agents at their goals in the parent but not in _C,
+  // e.g., PIBT::activated; nullptr -> computed by scanning all agents;
+  // C_parent: configuration of the parent, nullptr -> materialized here;
+  // the parent must be still open
+  HNode(const Config &_C, DistTable *D, HNode *_parent = nullptr, int _g = 0,
+        int _h = 0, const std::vector<int> *activated = nullptr,
+        const Config *C_parent = nullptr);
+  // restored from a checkpoint, stored fully and without the expansion
+  // state, the parent is set afterwards
+  HNode(const Config &_C, int _g, int _h, int _depth);
   ~HNode();
+
+  // materialize the configuration, use ConfigCache in hot loops
+  Config get_config() const;
+  // C: configuration of delta_base -> configuration of this node
+  void apply_diff(Config &C) const;
+
+  // pop the next constraint from the low-level search tree,
+  // nullptr -> the tree is exhausted; valid until the next call;
+  // C: configuration of this node
+  LNode *pop_constraint(const Config &C, std::mt19937 &MT);
+  // write all constraints of L to Q_to, constrained agents in depth order
+  void get_constraints(const LNode *L, Config &Q_to,
+                       std::vector<int> &agents) const;
+  // append settled agents to order
+  void complete_order();
+  // free the expansion state
+  void release();
+  // move the full configuration to disk, only for released nodes
+  bool spill(SpillFile &file);  // false -> failed to write, kept in memory
+  bool is_spilled() const;
+  size_t memory_usage() const;  // approximate, bytes
 };
 using HNodes = std::vector<HNode *>;
 
+// configurations from the initial node to H
+Solution backtrack(const HNode *H);
+
+// explored configurations, keyed by hash; collisions are resolved by
+// comparing materialized configurations
+using Explored = std::unordered_multimap<uint64_t, HNode *>;
+// one entry of Explored, node of the hash map and its bucket, for MemoryBudget
+constexpr size_t EXPLORED_ENTRY_BYTES = 48;
+
+// OPEN of LaCAM, a stack of distinct nodes;
+// pushing a node already in OPEN moves it to the front and leaves a
+// tombstone, which are compacted once they outnumber the nodes
+struct OpenList {
+  std::vector<HNode *> nodes;  // front = back of the vector
+  size_t num_nodes;
+  size_t num_tombstones;
+
+  OpenList();
+  ~OpenList();
+  bool empty() const;
+  size_t size() const;  // distinct nodes
+  HNode *front() const;
+  void push_front(HNode *H);
+  void pop_front();
+  HNode *get_random(std::mt19937 &MT) const;  // O(1) in expectation
+  void compact();
+};
+
+// recently materialized configurations of delta-encoded HNodes, per thread;
+// a reference from get() stays valid for the next (size - 1) calls
+struct ConfigCache {
+  std::vector<const HNode *> nodes;
+  std::vector<Config> configs;
+  size_t next;
+  Config scratch;
+  std::vector<const HNode *> chain;
+
+  ConfigCache(int size = 4);
+  // keep = false -> use a scratch buffer, valid until the next such call
+  const Config &get(const HNode *H, const bool keep = true);
+  bool is_same(const HNode *H, const Config &C);
+  void materialize(const HNode *H, Config &C);
+};
+
 struct LaCAM {
   const Instance *ins;
   DistTable *D;
   const Deadline *deadline;
+  DeadlineChecker deadline_checker;  // amortized checks in the search loop
   const int seed;
   std::mt19937 MT;
   std::uniform_real_distribution<float> rrd;  // random, real distribution
   const int verbose;
+  MemoryBudget *budget;  // nullptr -> no accounting
+  const ImproveCallback on_improve;  // nullptr -> no notification
 
   // solver utils
   PIBT pibt;
+  ConfigCache config_cache;
+  Explored EXPLORED;
+  HNodes GC_HNodes;  // all nodes, deleted with the solver
+  HNode *H_init;
+  const uint64_t goal_hash;
   HNode *H_goal; // 用于记录“已找到的目标解节点”（即所有智能体都到达终点时的高层节点）的指针变量。它在高层搜索过程中用于判断是否已经找到解、剪枝冗余搜索分支，以及最终回溯并提取路径方案时作为起点。如果 H_goal 为空，说明尚未找到解；一旦被赋值，就代表找到了至少一个可行解
-  std::deque<HNode *> OPEN;
+  OpenList OPEN;
   int loop_cnt;
+  std::vector<int> constrained_agents;  // buffer for set_new_config
+  size_t accounted;   // bytes reported to budget
+  size_t open_bytes;  // part of accounted for OPEN
+  // step of MemoryBudget::Status reached by this solver, the budget may be
+  // shared by concurrent solvers and records the furthest step among them
+  int memory_status;
+  Solution rollout_solution;  // fallback when running out of memory
+  std::unique_ptr<SpillFile> spill_file;  // cold configurations
+  double last_checkpoint_ms;
+  bool finished;  // set by step() when the search loop ends
+  bool anytime;   // ANYTIME at construction, may be set per solver
+  // CHECKPOINT_FILE and RESUME_FILE at construction, may be set per solver
+  std::string checkpoint_file;
+  std::string resume_file;
+  // batched expansion, nullptr -> one constraint per iteration
+  std::unique_ptr<ThreadPool> batch_pool;
+  std::vector<PIBT> batch_pibts;  // slots 1, 2, ..., slot 0 is pibt
+  std::vector<Config> batch_Q;
+  std::vector<std::vector<int>> batch_C;
+  std::vector<char> batch_res;
 
   // Hyperparameters
   static bool ANYTIME;
   static float RANDOM_INSERT_PROB1;
   static float RANDOM_INSERT_PROB2;
+  static std::string SPILL_DIR;  // empty -> all nodes are kept in memory
+  static std::string CHECKPOINT_FILE;  // empty -> no checkpoint
+  static double CHECKPOINT_INTERVAL_MS;
+  static std::string RESUME_FILE;  // empty -> start from scratch
+  // > 1 -> up to BATCH_SIZE constraints of a node are evaluated by PIBT in
+  // parallel, deterministic for a fixed size; checkpoints keep slot 0 only
+  static int BATCH_SIZE;
 
   LaCAM(const Instance *_ins, DistTable *_D, int _verbose = 0,
-        const Deadline *_deadline = nullptr, int _seed = 0);
+        const Deadline *_deadline = nullptr, int _seed = 0,
+        MemoryBudget *_budget = nullptr,
+        const ImproveCallback &_on_improve = nullptr);
   ~LaCAM();
   Solution solve();
   Solution solve_beam(); // beam search的方法
+  // resumable search, e.g., to interleave many plans on a few threads:
+  // init() once, then step() until it returns false, result() at any time
+  void init();
+  // run at most max_iterations, or max_us microseconds if positive;
+  // false -> the search has ended (solved, exhausted, deadline or memory)
+  bool step(const int max_iterations, const double max_us = 0);
+  bool iterate();  // one iteration, false -> stop the search
+  bool expand_batch(HNode *H);
+  PIBT &get_slot(const int k);
+  void insert_successor(HNode *H, const Config &Q_to,
+                        const std::vector<int> &activated);
+  Solution result() const;  // best solution so far, empty -> none yet
+  void finish();
   bool set_new_config(HNode *S, LNode *M, Config &Q_to);
+  LNode *pop_constraint(HNode *H);
+  void add_explored(HNode *H);
+  void release(HNode *H);
+  void spill(HNode *H);  // if a spill file is used and has space
+  // true -> stop the search, see MemoryBudget::Status
+  bool check_memory();
+  void rollout(HNode *H);
+  void allocate(size_t bytes);
+  void deallocate(size_t bytes);
+  HNode *find_explored(const Config &Q, const uint64_t hash);
+  bool is_goal(const HNode *H);
+  // binary snapshot of the search, see lacam_checkpoint.cpp
+  bool save_checkpoint(const std::string &filename);
+  bool load_checkpoint(const std::string &filename);
   void rewrite(HNode *H_from, HNode *H_to);
-  int get_g_val(HNode *H_parent, const Config &Q_to);
+  void notify_improvement();
+  // activated: agents leaving their goals from H_parent to Q_to, c.f., PIBT;
+  // with the active agents of H_parent, every agent off its goal in Q_to
+  int get_g_val(const HNode *H_parent, const std::vector<int> &activated);
   int get_h_val(const Config &Q);
+  int get_h_val(const HNode *H_parent, const Config &Q_to,
+                const std::vector<int> &activated);
   int get_edge_cost(const Config &Q1, const Config &Q2);
 
   // utilities
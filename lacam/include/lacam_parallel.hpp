@@ -0,0 +1,134 @@
+/*
+ * shared-memory parallel LaCAM
+ *
+ * Worker threads expand high-level nodes from per-thread OPEN deques with
+ * work stealing; successors are generated by thread-local PIBT instances
+ * and deduplicated through a lock-free explored table.
+ * In deterministic mode, the search proceeds in synchronous rounds: the
+ * constraints of one round are extracted serially, configurations are
+ * generated in parallel, and results are inserted in a fixed order.
+ *
+ * Tree rewiring (anytime mode) is not supported; the search returns the
+ * first solution found. With a memory budget, the search only stops at the
+ * limit, there is no degradation.
+ */
+#pragma once
+
+#include "dist_table.hpp"
+#include "graph.hpp"
+#include "instance.hpp"
+#include "lacam.hpp"
+#include "pibt.hpp"
+#include "utils.hpp"
+
+// insert-only hash set of high-level nodes
+// chaining with compare-and-swap on bucket heads, no locks
+struct ConcurrentExplored {
+  struct Entry {
+    HNode *H;
+    const uint64_t hash;
+    Entry *next;
+  };
+  const size_t mask;
+  std::vector<std::atomic<Entry *>> buckets;
+
+  ConcurrentExplored(const int num_buckets_log2 = 20);
+  ~ConcurrentExplored();
+
+  // hash: get_config_hash(Q); cache: thread-local
+  HNode *find(const Config &Q, const uint64_t hash, ConfigCache &cache) const;
+  // return the node having the same configuration, or H if it is inserted;
+  // Q: configuration of H
+  HNode *insert(HNode *H, const Config &Q, ConfigCache &cache);
+
+  template <typename F>
+  void for_each(F &&f) const
+  {
+    for (auto &&b : buckets) {
+      for (auto e = b.load(); e != nullptr; e = e->next) f(e->H);
+    }
+  }
+};
+
+// OPEN of each thread, the owner uses the front, thieves use the back
+struct WorkDeque {
+  std::mutex mtx;
+  std::deque<HNode *> nodes;
+};
+
+struct ParallelLaCAM {
+  const Instance *ins;
+  DistTable *D;
+  const Deadline *deadline;
+  const int seed;
+  const int verbose;
+  const int num_threads;
+  MemoryBudget *budget;  // nullptr -> no accounting
+  const ImproveCallback on_improve;  // called once, by the finding thread
+
+  // solver utils
+  ThreadPool pool;
+  std::vector<PIBT> pibts;       // thread-local (or slot-local) PIBT
+  std::vector<std::mt19937> MTs;  // thread-local random generators
+  std::vector<ConfigCache> caches;  // thread-local (or slot-local)
+  const uint64_t goal_hash;
+  ConcurrentExplored EXPLORED;
+  std::vector<std::mutex> node_locks;  // striped locks for HNodes
+  std::vector<WorkDeque> OPENs;
+  HNode *H_init;
+  std::atomic<HNode *> H_goal;
+  std::atomic<int> num_pending;  // nodes in OPENs + nodes in process
+  std::atomic<bool> stop;
+  std::atomic<int> loop_cnt;
+  std::atomic<int> num_explored;
+
+  // Hyperparameters
+  static int NUM_THREADS;
+  static bool DETERMINISTIC;
+  static int EXPLORED_BUCKETS_LOG2;
+
+  ParallelLaCAM(const Instance *_ins, DistTable *_D, int _verbose = 0,
+                const Deadline *_deadline = nullptr, int _seed = 0,
+                int _num_threads = NUM_THREADS,
+                MemoryBudget *_budget = nullptr,
+                const ImproveCallback &_on_improve = nullptr);
+  ~ParallelLaCAM();
+  Solution solve();
+  void search_work_stealing();
+  void search_deterministic();
+  void worker(const int w);
+
+  std::mutex &get_lock(const HNode *H);
+  void push_front(const int w, HNode *H);
+  HNode *pop(const int w);
+  // order: active agents of H, copied under the lock
+  bool extract_constraint(HNode *H, const Config &Q_from, std::mt19937 &MT,
+                          Config &Q_to, std::vector<int> &constrained_agents,
+                          std::vector<int> &order);
+  void finish_constraint(HNode *H);
+  void release(HNode *H);  // with the lock of H
+  bool is_stopped(DeadlineChecker &checker);  // deadline or memory budget
+  bool set_new_config(const Config &Q_from, Config &Q_to,
+                      const std::vector<int> &constrained_agents,
+                      const std::vector<int> &order, PIBT &pibt);
+  // Q_from: configuration of H
+  HNode *insert_config(HNode *H, const Config &Q_from, const Config &Q_to,
+                       const std::vector<int> &activated, ConfigCache &cache,
+                       bool &is_new);
+  bool is_goal(const HNode *H, ConfigCache &cache);
+  // with the lock of H_parent, c.f., LaCAM
+  int get_g_val(const HNode *H_parent, const std::vector<int> &activated);
+  int get_h_val(const Config &Q);
+  int get_h_val(const HNode *H_parent, const Config &Q_to,
+                const std::vector<int> &activated);
+
+  // utilities
+  template <typename... Body>
+  void solver_info(const int level, Body &&...body)
+  {
+    if (verbose < level) return;
+    std::cout << "elapsed:" << std::setw(6) << elapsed_ms(deadline) << "ms"
+              << "  loop_cnt:" << std::setw(8) << loop_cnt << "\t";
+    info(level, verbose, (body)...);
+  }
+};
@@ -0,0 +1,96 @@
+/*
+ * large neighborhood search, post-optimization of a solution
+ *
+ * Paths of a subset of agents (a neighborhood) are removed and replanned
+ * one by one, in random order, by space-time A* against a reservation
+ * table of the other paths; new paths are kept when the sum of loss of the
+ * subset decreases. Neighborhoods:
+ * - RANDOM: uniformly random agents
+ * - AGENT: a delayed agent and the agents whose paths cross its path
+ * - MAP: agents passing through an area around a random vertex
+ * chosen by roulette over weights adapted to their recent gains.
+ * In each round, NUM_THREADS neighborhoods are destroyed and repaired in
+ * parallel against the same table; improvements are applied in the order
+ * of gains and dropped when they collide with an applied one.
+ *
+ * reference:
+ * Anytime Multi-Agent Path Finding via Large Neighborhood Search.
+ * Jiaoyang Li, Zhe Chen, Daniel Harabor, Peter J. Stuckey & Sven Koenig.
+ * Proc. Int. Joint Conf. on Artificial Intelligence (IJCAI). 2021.
+ */
+#pragma once
+
+#include "dist_table.hpp"
+#include "graph.hpp"
+#include "instance.hpp"
+#include "lacam.hpp"
+#include "metrics.hpp"
+#include "utils.hpp"
+
+// a repaired neighborhood
+struct LNSCandidate {
+  int type;
+  std::vector<int> agents;  // in the order of replanning
+  Paths paths;              // new paths of agents, empty -> failed
+  int gain;                 // decrease of the sum of loss
+};
+
+struct LNS {
+  enum Neighborhood { RANDOM, AGENT, MAP, NUM_NEIGHBORHOODS };
+
+  const Instance *ins;
+  DistTable *D;  // complete, read by all threads
+  const int verbose;
+  const Deadline *deadline;
+  const int num_threads;    // NUM_THREADS, at least one
+  const int neighbor_size;  // NEIGHBOR_SIZE, at least one
+
+  // paths end at the arrival, agents stay at their goals afterwards
+  Paths paths;
+  int sum_of_loss;
+  int lower_bound;
+  // vertex id -> (t, agent) ascending, before the arrival of the agent
+  std::vector<std::vector<std::pair<int, int>>> table;
+  std::vector<int> goal_owner;  // vertex id -> agent, -1 -> none
+  std::vector<double> weights;  // of neighborhoods
+  std::vector<std::mt19937> MTs;  // per thread
+  QualityCurve curve;
+  ThreadPool pool;
+
+  // Hyperparameters
+  static bool ENABLED;
+  static int NUM_THREADS;    // neighborhoods repaired concurrently
+  static int NEIGHBOR_SIZE;  // agents per neighborhood
+  static double REACTION;    // speed of the adaptation of weights
+  static int MAX_ROUNDS;
+
+  LNS(const Instance *_ins, DistTable *_D, const Solution &solution,
+      int _verbose = 0, const Deadline *_deadline = nullptr, int seed = 0);
+
+  // until the deadline, MAX_ROUNDS, or the lower bound;
+  // on_improve is called with each improved solution
+  Solution optimize(const ImproveCallback &on_improve = nullptr);
+  Solution get_solution() const;
+
+  // reservation table
+  void add_path(const int i, const Path &path);
+  void remove_path(const int i);
+  // agents in removed are ignored, paths in overlay are added
+  bool is_occupied(const Vertex *v, const int t,
+                   const std::vector<char> &removed,
+                   const Paths &overlay) const;
+  bool is_swapped(const Vertex *from, const Vertex *to, const int t,
+                  const std::vector<char> &removed,
+                  const Paths &overlay) const;
+  // last timestep when others use v, -1 -> never
+  int get_last_use(const Vertex *v, const std::vector<char> &removed,
+                   const Paths &overlay) const;
+
+  std::vector<int> get_neighborhood(const int type, std::mt19937 &MT) const;
+  LNSCandidate destroy_and_repair(const int k);
+  // space-time A*, costs are the loss; empty -> no path with loss <= max_f
+  Path find_path(const int i, const std::vector<char> &removed,
+                 const Paths &overlay, const int max_f,
+                 DeadlineChecker &checker) const;
+  int apply(const LNSCandidate &c);  // gain, 0 -> not applied, unchanged
+};
@@ -21,5 +21,8 @@ int get_sum_of_loss(const Solution &solution);
 int get_sum_of_loss(const Solution &solution, std::vector<int> &agents_subset);
 int get_sum_of_loss_paths(const std::vector<Path> &solution);
 
+// quality over time, (elapsed ms, sum of loss) at each improvement
+using QualityCurve = std::vector<std::pair<double, int>>;
+
 int get_makespan_lower_bound(const Instance &ins, DistTable &D);
 int get_sum_of_costs_lower_bound(const Instance &ins, DistTable &D);
@@ -23,13 +23,78 @@
 #include "instance.hpp"
 #include "utils.hpp"
 
-// dist, hindrance, tie
-using PIBTHeuristic = std::tuple<int, int, float>;
+// random generator for tie-breaking, any UniformRandomBitGenerator works
+// e.g., std::mt19937
+using PIBTRandomEngine = Xoshiro256pp;
+
+// candidate ranking key, compared as one unsigned integer
+// [63:36] dist, [35:32] hindrance, [31:3] random tie-break, [2:0] index
+using PIBTKey = uint64_t;
+
+// frame of priority inheritance, replacing a recursive call
+struct PIBTFrame {
+  int i;           // agent
+  int k;           // index of the candidate being tried
+  int swap_agent;  // agent pulled by swap, or NO_AGENT
+  bool waiting;    // waiting for the result of priority inheritance
+};
+
+// dynamic priorities in fixed-point, PRIORITY_ONE stands for 1.0;
+// +1 while away from the goal, reset to the fractional part at the goal
+using Priority = int64_t;
+static constexpr Priority PRIORITY_ONE = 10000;
+
+// higher priority first, ties are broken by agent index
+inline bool has_higher_priority(const std::vector<Priority> &P, const int i,
+                                const int j)
+{
+  return P[i] != P[j] ? P[i] > P[j] : i < j;
+}
+
+// update priorities, and build the order of agents away from their goals by
+// a linear merge, instead of sorting all agents;
+// [prev_begin, prev_end): previous active agents, sorted by priorities
+// activated: agents that have left their goals
+// is_active(i): agent-i is away from its goal now
+template <typename IsActive>
+void update_active_order(const int *prev_begin, const int *prev_end,
+                         const std::vector<int> &activated,
+                         IsActive &&is_active, std::vector<Priority> &P,
+                         std::vector<int> &order)
+{
+  // newcomers, all of them are away from their goals
+  auto newcomers = activated;
+  for (auto i : newcomers) P[i] += PRIORITY_ONE;
+  auto cmp = [&](int i, int j) { return has_higher_priority(P, i, j); };
+  std::sort(newcomers.begin(), newcomers.end(), cmp);
+
+  // active agents keep their relative order, all of them get +1
+  order.clear();
+  auto itr = newcomers.begin();
+  for (auto p = prev_begin; p != prev_end; ++p) {
+    const auto i = *p;
+    if (!is_active(i)) {
+      P[i] %= PRIORITY_ONE;
+      continue;
+    }
+    P[i] += PRIORITY_ONE;
+    while (itr != newcomers.end() && cmp(*itr, i)) order.push_back(*itr++);
+    order.push_back(i);
+  }
+  order.insert(order.end(), itr, newcomers.end());
+}
+
+// thread-local working memory of PIBT
+struct PIBTScratch {
+  std::array<PIBTKey, 5> C_key;        // action cost
+  std::array<int, 4> neighbor_agents;  // for hindrance
+  std::vector<PIBTFrame> stack;        // explicit stack, reused across calls
+};
 
 struct PIBT {
   const Instance *ins;
-  std::mt19937 MT;
-  std::uniform_real_distribution<float> rrd;  // random, real distribution
+  PIBTRandomEngine MT;
+  const uint64_t tie_seed;  // for counter-based tie-breaking
 
   // solver utils
   const int N;  // number of agents
@@ -38,26 +103,101 @@ struct PIBT {
 
   // specific to PIBT
   const int NO_AGENT;
-  std::vector<int> occupied_now;                 // for quick collision checking
-  std::vector<int> occupied_next;                // for quick collision checking
+  // agents at their goals are not registered in occupied_now; they are found
+  // through this static layer instead, unless the goals are not unique
+  std::vector<int> goal_owner;  // vertex -> agent having it as the goal
+  bool unique_goals;
+  const Config *Q_from_now;  // configuration of the current call
+  // for quick collision checking, entries are stamped with the call epoch;
+  // stale entries read as empty, thus no cleanup is required
+  uint epoch;
+  std::vector<uint64_t> occupied_now;   // (epoch << 32) | agent
+  std::vector<uint64_t> occupied_next;  // (epoch << 32) | agent
+  std::vector<uint> active_epoch;       // epoch if in order[0, num_active)
+  std::vector<int> constrained_agents;  // scratch for set_new_config
+  std::vector<int> displaced_agents;    // settled agents hit by constraints
+  std::vector<int> activated;  // agents leaving their goals in the last call
   std::vector<std::array<Vertex *, 5> > C_next;  // next location candidates
-  std::array<PIBTHeuristic, 5> C_cost;           // action cost
   std::vector<std::array<int, 5> > C_indices;    // action index
 
+  // cluster mode, agents are partitioned into independent groups per call
+  const int num_threads;
+  std::unique_ptr<ThreadPool> pool;     // nullptr -> serial
+  std::vector<PIBTScratch> scratches;   // one per thread
+  std::vector<uint64_t> claimed;        // (epoch << 32) | agent, per vertex
+  std::vector<int> uf_parent;           // union-find over agents
+  std::vector<uint64_t> cluster_of;     // (epoch << 32) | cluster, per root
+  std::vector<int> cluster_start;       // members of cluster-c are
+  std::vector<int> cluster_members;     // [cluster_start[c], [c + 1])
+  std::vector<int> cluster_cursor;      // scratch for bucketing
+
   // hyper parameters
   static bool SWAP;
   static bool HINDRANCE;
+  static bool CLUSTER;     // counter-based tie-breaking, allows clustering
+  static int NUM_THREADS;  // > 1 -> solve clusters in parallel
 
-  PIBT(const Instance *_ins, DistTable *_D, int seed = 0);
+  PIBT(const Instance *_ins, DistTable *_D, int seed = 0,
+       int _num_threads = NUM_THREADS);
+  PIBT(PIBT &&) = default;
   ~PIBT();
 
   bool set_new_config(const Config &Q_from, Config &Q_to,
                       const std::vector<int> &order);
-  bool funcPIBT(const int i, const Config &Q_from, Config &Q_to);
+  // constrained: agents whose Q_to are already given
+  bool set_new_config(const Config &Q_from, Config &Q_to,
+                      const std::vector<int> &order,
+                      const std::vector<int> &constrained);
+  // agents other than order[0, num_active) must be at their goals;
+  // they are skipped unless pushed, pulled, or displaced by constraints
+  bool set_new_config(const Config &Q_from, Config &Q_to,
+                      const std::vector<int> &order,
+                      const std::vector<int> &constrained,
+                      const int num_active);
+  // solve the clusters of agents with disjoint neighborhoods in parallel
+  bool set_new_config_clusters(const Config &Q_from, Config &Q_to,
+                               const std::vector<int> &order,
+                               const int num_active);
+  int find_cluster_root(int i);
+  bool funcPIBT(const int i, const Config &Q_from, Config &Q_to,
+                PIBTScratch &S);
+  // set & sort candidates of agent-i, return the swap agent
+  int set_candidates(const int i, const Config &Q_from, Config &Q_to,
+                     PIBTScratch &S);
+  void swap_operation(const int i, const int swap_agent, const Config &Q_from,
+                      Config &Q_to);
+  // sort candidate keys and store the ranking to C_indices[i]
+  void rank_candidates(const int i, const int num_candidates, PIBTScratch &S);
 
   int is_swap_required_and_possible(const int ai, const Config &Q_from,
                                     Config &Q_to, Vertex *v_i_target);
   bool is_swap_required(const int pusher, const int puller,
                         Vertex *v_pusher_origin, Vertex *v_puller_origin);
   bool is_swap_possible(Vertex *v_pusher_origin, Vertex *v_puller_origin);
+
+  void next_epoch();
+  inline int get_occupied_now(const Vertex *v) const
+  {
+    const auto x = occupied_now[v->id];
+    return (x >> 32) == epoch ? (int)(uint32_t)x : get_settled_agent(v);
+  }
+  // agent staying at its goal v, not registered in occupied_now
+  inline int get_settled_agent(const Vertex *v) const
+  {
+    const auto j = goal_owner[v->id];
+    return (j != NO_AGENT && (*Q_from_now)[j] == v) ? j : NO_AGENT;
+  }
+  inline int get_occupied_next(const Vertex *v) const
+  {
+    const auto x = occupied_next[v->id];
+    return (x >> 32) == epoch ? (int)(uint32_t)x : NO_AGENT;
+  }
+  inline void set_occupied_now(const Vertex *v, const int i)
+  {
+    occupied_now[v->id] = ((uint64_t)epoch << 32) | (uint32_t)i;
+  }
+  inline void set_occupied_next(const Vertex *v, const int i)
+  {
+    occupied_next[v->id] = ((uint64_t)epoch << 32) | (uint32_t)i;
+  }
 };
@@ -0,0 +1,62 @@
+/*
+ * standalone PIBT, i.e., repeated one-step planning without high-level search
+ *
+ * Only the current configuration is kept and every step is passed to a
+ * callback, so the memory usage is O(N) regardless of the makespan
+ * (besides the distance table).
+ *
+ * reference:
+ * Priority Inheritance with Backtracking for Iterative Multi-agent Path
+ * Finding. Keisuke Okumura, Manao Machida, Xavier Défago & Yasumasa Tamura.
+ * Artificial Intelligence (AIJ). 2022.
+ */
+#pragma once
+
+#include "dist_table.hpp"
+#include "graph.hpp"
+#include "instance.hpp"
+#include "pibt.hpp"
+#include "utils.hpp"
+
+// solution quality computed on the fly
+struct RolloutStats {
+  bool solved;
+  int makespan;
+  int sum_of_costs;
+  int sum_of_loss;
+  int makespan_lb;
+  int sum_of_costs_lb;
+};
+
+struct PIBTRollout {
+  const Instance *ins;
+  DistTable *D;
+  const Deadline *deadline;
+  const int verbose;
+
+  // solver utils
+  PIBT pibt;
+  Config Q_from;
+  Config Q_to;
+  std::vector<Priority> priorities;
+  std::vector<int> order;       // agents away from their goals
+  std::vector<int> order_next;  // buffer for update_priorities
+  std::vector<int> last_off_goal;  // last timestep not at the goal
+  int max_timestep;  // MAX_TIMESTEP unless the caller has a tighter bound
+
+  // Hyperparameters
+  static int MAX_TIMESTEP;
+
+  // num_threads: of PIBT, e.g., 1 when rollouts already run in parallel
+  PIBTRollout(const Instance *_ins, DistTable *_D, int _verbose = 0,
+              const Deadline *_deadline = nullptr, int _seed = 0,
+              int num_threads = PIBT::NUM_THREADS);
+  ~PIBTRollout();
+
+  // on_step(t, Q) is called for every configuration, including the initial
+  RolloutStats run(const Config &Q_init,
+                   const std::function<void(int, const Config &)> &on_step);
+  // keep all configurations, for small instances or as a library call
+  Solution solve();
+  void update_priorities(const Config &Q, const bool init);
+};
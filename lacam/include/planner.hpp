@@ -1,12 +1,88 @@
 #pragma once
 
+#include "decomposition.hpp"
 #include "dist_table.hpp"
 #include "graph.hpp"
 #include "instance.hpp"
 #include "lacam.hpp"
+#include "lacam_parallel.hpp"
+#include "lns.hpp"
+#include "pibt_rollout.hpp"
 #include "planner.hpp"
+#include "portfolio.hpp"
 #include "post_processing.hpp"
+#include "region_planner.hpp"
 #include "utils.hpp"
 
+// budget: accounting of the distance table and search nodes, see
+// MemoryBudget; its status tells how the search degraded;
+// on_improve: called with each new best solution, e.g., in anytime mode,
+// see SolutionHandle for sharing it with other threads;
+// D: a complete table of ins kept by the caller, e.g., for optimize_lns,
+// nullptr -> built for this call
 Solution solve(const Instance &ins, const int verbose = 0,
-               const Deadline *deadline = nullptr, int seed = 0);
+               const Deadline *deadline = nullptr, int seed = 0,
+               MemoryBudget *budget = nullptr,
+               const ImproveCallback &on_improve = nullptr,
+               DistTable *D = nullptr);
+
+// anytime LaCAM that answers early: start() returns the first solution and
+// the search continues on the same state in a background thread, improved
+// solutions are delivered to handle (and on_improve) until the deadline;
+// ins, deadline and budget must outlive this object
+struct BackgroundRefinement {
+  const Instance *ins;
+  const int verbose;
+  const Deadline *deadline;
+  MemoryBudget *budget;
+  DistTable D;
+  size_t table_bytes;  // accounted to budget
+  SolutionHandle handle;
+  const ImproveCallback on_improve;
+  LaCAM lacam;
+  std::atomic<bool> stopping;
+  std::atomic<bool> refining;
+  std::thread worker;
+
+  // a stop request is noticed within STOP_CHECK_US
+  static double STOP_CHECK_US;
+
+  BackgroundRefinement(const Instance &_ins, const int _verbose = 0,
+                       const Deadline *_deadline = nullptr, int seed = 0,
+                       MemoryBudget *_budget = nullptr,
+                       const ImproveCallback &_on_improve = nullptr);
+  ~BackgroundRefinement();  // stop()
+
+  // block until the first solution, empty -> no solution within the
+  // deadline or unsolvable; otherwise the refinement starts
+  Solution start();
+  void join();  // wait until the deadline or optimality
+  void stop();  // interrupt the refinement and wait for it
+  bool is_running() const;
+};
+
+// PIBT per region of the tiled map, see RegionPlanner; empty -> failed
+Solution solve_regions(const Instance &ins, const int verbose = 0,
+                       const Deadline *deadline = nullptr, int seed = 0);
+
+// LaCAM in Portfolio::NUM_PROCESSES forked processes, see Portfolio
+Solution solve_portfolio(const Instance &ins, const int verbose = 0,
+                         const Deadline *deadline = nullptr, int seed = 0,
+                         MemoryBudget *budget = nullptr,
+                         const ImproveCallback &on_improve = nullptr);
+
+// post-optimization of a solution by LNS until the deadline, see LNS;
+// curve: quality over time, starting with the given solution;
+// D: the table of solve, nullptr -> a complete one is built
+Solution optimize_lns(const Instance &ins, const Solution &solution,
+                      const int verbose = 0,
+                      const Deadline *deadline = nullptr, int seed = 0,
+                      QualityCurve *curve = nullptr,
+                      const ImproveCallback &on_improve = nullptr,
+                      DistTable *D = nullptr);
+
+// standalone PIBT, each configuration is passed to on_step instead of stored
+RolloutStats solve_pibt(const Instance &ins,
+                        const std::function<void(int, const Config &)> &on_step,
+                        const int verbose = 0,
+                        const Deadline *deadline = nullptr, int seed = 0);
@@ -0,0 +1,83 @@
+/*
+ * portfolio of solver processes on one machine
+ *
+ * The coordinator builds the full distance table and forks NUM_PROCESSES
+ * children. The graph and the table are shared read-only as copy-on-write
+ * pages; the table is complete, so no page of it is copied. Each child runs
+ * LaCAM with its own seed, optionally pinned to a CPU, and publishes its
+ * improvements to a slot in anonymous shared memory. The coordinator
+ * cancels all children once the best cost reaches TARGET_RATIO times the
+ * lower bound, at the deadline, or on SIGINT.
+ * The slot is guarded by a robust process-shared mutex, so a child killed
+ * while holding it, e.g., by the OOM killer, does not block the others.
+ * With a memory budget, each child gets an equal share of what the table
+ * leaves.
+ */
+#pragma once
+
+#include <pthread.h>
+#include <sys/types.h>
+
+#include "dist_table.hpp"
+#include "graph.hpp"
+#include "instance.hpp"
+#include "lacam.hpp"
+#include "metrics.hpp"
+#include "utils.hpp"
+
+// header of the shared memory, followed by the plan:
+// vertex ids (uint32_t), timestep-major, `capacity` timesteps at most
+struct PortfolioSlot {
+  pthread_mutex_t mutex;     // robust, process-shared
+  bool writing;              // the plan is being overwritten
+  std::atomic<int> cost;     // sum of loss, -1 -> no solution yet
+  std::atomic<int> version;  // incremented at each update
+  std::atomic<int> process;  // publisher of the best solution
+  std::atomic<int> dropped;  // plans longer than the slot
+  // memory of children, accumulated into the budget of the coordinator
+  std::atomic<size_t> memory_peak;  // sum of peaks, bytes
+  std::atomic<int> memory_status;   // furthest MemoryBudget::Status
+  CancelToken cancel;        // set by the coordinator
+  int length;                // number of configurations of the plan
+
+  PortfolioSlot();
+  ~PortfolioSlot();
+};
+
+struct Portfolio {
+  const Instance *ins;
+  const int verbose;
+  const Deadline *deadline;
+  const int seed;
+  MemoryBudget *budget;  // nullptr -> no accounting
+  const ImproveCallback on_improve;  // called by the coordinator
+  DistTable D;
+  size_t table_bytes;  // accounted to budget
+  size_t slot_bytes;
+  size_t capacity;  // timesteps fitting in the slot
+  PortfolioSlot *slot;
+  uint32_t *plan;  // right after the header
+  std::vector<pid_t> children;
+
+  // Hyperparameters
+  static int NUM_PROCESSES;
+  static float TARGET_RATIO;  // stop at cost <= ratio * lower bound, 0 -> off
+  static bool PIN_CPUS;       // child k runs on CPU k mod #CPUs
+  static double SLOT_MB;      // reserved, pages are committed on demand
+  static double POLL_MS;      // coordinator
+
+  Portfolio(const Instance *_ins, int _verbose = 0,
+            const Deadline *_deadline = nullptr, int _seed = 0,
+            MemoryBudget *_budget = nullptr,
+            const ImproveCallback &_on_improve = nullptr);
+  ~Portfolio();
+
+  Solution solve();  // empty -> no process found a solution
+  [[noreturn]] void run_child(const int k);
+  // keep the solution if it is better than the published one
+  bool publish(const Solution &solution, const int k);
+  int read(Solution &solution);  // return the cost
+  // a plan left half-written by a dead owner is discarded
+  void lock();
+  void unlock();
+};
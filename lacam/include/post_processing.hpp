@@ -5,6 +5,7 @@
 #include "dist_table.hpp"
 #include "instance.hpp"
 #include "metrics.hpp"
+#include "pibt_rollout.hpp"
 #include "utils.hpp"
 
 bool is_feasible_solution(const Instance &ins, const Solution &solution,
@@ -12,8 +13,46 @@ bool is_feasible_solution(const Instance &ins, const Solution &solution,
 void print_stats(const int verbose, const Deadline *deadline,
                  const Instance &ins, const Solution &solution,
                  const double comp_time_ms);
+void print_stats(const int verbose, const Deadline *deadline,
+                 const RolloutStats &stats, const double comp_time_ms);
 void make_log(const Instance &ins, const Solution &solution,
               const std::string &output_name, const double comp_time_ms,
               const std::string &map_name, const std::string &scen_name, const int seed,
-              const bool log_short = false  // true -> paths not appear
-);
+              const bool log_short = false,  // true -> paths not appear
+              const MemoryBudget *budget = nullptr,
+              const QualityCurve *curve = nullptr);
+
+// the current best solution of an anytime search, replaced atomically;
+// count: number of improvements so far, cost: g of the search
+void make_improvement_log(const Instance &ins, const Solution &solution,
+                          const int cost, const int count,
+                          const std::string &output_name,
+                          const double comp_time_ms,
+                          const std::string &map_name, const int seed);
+
+// quality over time appended as csv rows, e.g., of LNS for benchmarks:
+// map,scen,agents,seed,elapsed_ms,sum_of_loss; the header for a new file
+void make_curve_log(const Instance &ins, const QualityCurve &curve,
+                    const std::string &output_name,
+                    const std::string &map_name, const std::string &scen_name,
+                    const int seed);
+
+// log writer for the rollout mode, configurations are written as they come
+// to <output_name>.paths and copied after the stats at the end, so that the
+// fields appear in the same order as make_log
+struct StreamingLog {
+  const Instance &ins;
+  const std::string output_name;
+  const std::string paths_name;
+  const std::string map_recorded_name;
+  const int seed;
+  const bool log_short;
+  std::ofstream paths;
+
+  StreamingLog(const Instance &_ins, const std::string &_output_name,
+               const std::string &map_name, const int _seed,
+               const bool _log_short = false);
+  void write_config(const int t, const Config &Q);
+  void close(const RolloutStats &stats, const double comp_time_ms,
+             const std::string &scen_name);
+};
@@ -0,0 +1,79 @@
+/*
+ * region-based planner for huge maps, without a joint search
+ *
+ * The graph is tiled into squares of TILE_SIZE; each connected component
+ * of a tile is a region. Agents are routed over the graph of regions and
+ * planned in epochs:
+ *
+ * 1. every region with agents runs PIBT for EPOCH_LENGTH steps on its own
+ *    subgraph, in parallel; agents head for their goals, or for a border
+ *    cell towards the next region on their route
+ * 2. agents waiting at a border cell are handed off to a free cell of the
+ *    next region; a cell is reserved by the first agent taking it, and an
+ *    agent staying at a reserved cell steps aside in the next epoch
+ *
+ * Regions share no vertex and no agent leaves its region during an epoch,
+ * so plans of regions never collide; the hand-off step only moves agents
+ * to unoccupied cells. The result is a usual Solution of the Instance.
+ * When agents get stuck at a border, e.g., in a corridor crossed in both
+ * directions, the two regions are merged and planned as one until nobody
+ * is stuck anymore; in the worst case this is PIBT on the whole graph.
+ * The planner is incomplete like PIBT; it fails when an epoch makes no
+ * progress and there is nothing left to merge.
+ */
+#pragma once
+
+#include "dist_table.hpp"
+#include "graph.hpp"
+#include "instance.hpp"
+#include "pibt_rollout.hpp"
+#include "utils.hpp"
+
+struct RegionPlanner {
+  const Instance *ins;
+  const Deadline *deadline;
+  const int seed;
+  const int verbose;
+  const int epoch_length;  // EPOCH_LENGTH, at least one step
+
+  // regions
+  std::vector<std::vector<int>> regions;  // vertex ids, ascending
+  std::vector<int> region_of;             // vertex id -> region
+  // region -> neighbor region -> cells at the border, ascending ids
+  std::vector<std::map<int, std::vector<int>>> exits;
+  // goal region -> distances over the graph of regions, computed lazily
+  std::vector<std::vector<int>> region_dists;
+
+  // state of an epoch
+  std::vector<int> group_of;  // region -> merged regions, union-find
+  std::vector<std::pair<int, int>> stuck;  // borders where hand-offs failed
+  std::vector<int> occupant;  // vertex id -> agent, -1 -> free
+  std::vector<int> reserved;  // vertex id -> agent waiting over the border
+
+  ThreadPool pool;
+
+  // Hyperparameters
+  static int TILE_SIZE;
+  static int EPOCH_LENGTH;  // PIBT steps between hand-offs
+  static int NUM_THREADS;   // groups of regions planned concurrently
+
+  RegionPlanner(const Instance *_ins, int _verbose = 0,
+                const Deadline *_deadline = nullptr, int _seed = 0);
+  ~RegionPlanner();
+
+  Solution solve();  // empty -> failed
+  void setup_regions();
+  const std::vector<int> &get_region_dists(const int goal_region);
+  // next region on the route from region r to goal_region, -1 -> none
+  int get_next_region(const int r, const int goal_region);
+  int find_group(const int r);
+  // PIBT on cells (ascending) of a group of regions, Q is the configuration
+  // at the beginning of the epoch; configs[t][i] is written for the agents
+  // of the group, returns the number of steps
+  int plan_group(const std::vector<int> &cells, const std::vector<int> &agents,
+                 const Config &Q, const int epoch,
+                 std::vector<Config> &configs);
+  // move agents waiting at a border into the next region, Q is updated;
+  // borders where agents could not move are recorded in stuck
+  int hand_off(Config &Q);
+};
@@ -0,0 +1,38 @@
+/*
+ * append-only store of configurations on local disk
+ *
+ * Cold high-level nodes, i.e., nodes whose low-level search is exhausted,
+ * are only used for duplicate detection and backtracking. Their full
+ * configurations are moved to a memory-mapped file, one fixed-size record
+ * per node, and read back on demand. The file is unlinked on creation, so
+ * it disappears with the process.
+ */
+#pragma once
+
+#include "graph.hpp"
+#include "utils.hpp"
+
+struct SpillFile {
+  // record: config hash (uint64_t) + vertex ids (uint32_t per agent)
+  const Graph *G;
+  const size_t N;
+  const size_t record_size;
+  int fd;
+  char *data;       // mapped region
+  size_t size;      // bytes written
+  size_t capacity;  // bytes mapped
+  bool failed;      // the file could not grow, no more records
+
+  static size_t INITIAL_CAPACITY;  // bytes, doubled on demand
+
+  // dir: directory of the file, e.g., a local SSD
+  SpillFile(const Graph *_G, const size_t _N, const std::string &dir);
+  ~SpillFile();
+  bool is_open() const;
+
+  // false -> no space left on the device, nothing is written
+  bool append(const uint64_t hash, const Config &C, uint64_t &offset);
+  uint64_t get_hash(const uint64_t offset) const;
+  void read(const uint64_t offset, Config &C) const;
+  size_t num_records() const;
+};
@@ -5,14 +5,19 @@
 
 #include <algorithm>
 #include <array>
+#include <atomic>
 #include <chrono>
 #include <climits>
+#include <condition_variable>
 #include <fstream>
+#include <functional>
 #include <future>
 #include <iomanip>
 #include <iostream>
 #include <list>
 #include <map>
+#include <memory>
+#include <mutex>
 #include <numeric>
 #include <queue>
 #include <random>
@@ -20,31 +25,151 @@
 #include <set>
 #include <stack>
 #include <string>
+#include <thread>
 #include <unordered_map>
 #include <vector>
 
 using Time = std::chrono::steady_clock;
 
+// stops solvers early, set from another thread or a signal handler
+struct CancelToken {
+  std::atomic<bool> cancelled;
+  static_assert(std::atomic<bool>::is_always_lock_free);
+
+  CancelToken();
+  void cancel();  // async-signal-safe
+  void reset();
+  bool is_cancelled() const;
+};
+
 // time manager
 struct Deadline {
   const Time::time_point t_s;
   const double time_limit_ms;
+  const CancelToken *token;  // nullptr -> not cancellable
 
-  Deadline(double _time_limit_ms = 0);
-  double elapsed_ms() const;
+  Deadline(double _time_limit_ms = 0, const CancelToken *_token = nullptr);
+  double elapsed_ms() const;  // whole milliseconds, for logs
   double elapsed_ns() const;
+  bool is_cancelled() const;
 };
 
 double elapsed_ms(const Deadline *deadline);
 double elapsed_ns(const Deadline *deadline);
+// sub-millisecond resolution, reads the clock at each call
 bool is_expired(const Deadline *deadline);
 bool is_expired(const Deadline &deadline);
+bool is_cancelled(const Deadline *deadline);
+
+// is_expired for hot loops: the token is checked at every call but the
+// clock only every `interval` calls, adapted so that clock reads are about
+// CHECK_PERIOD_US apart; one checker per thread
+struct DeadlineChecker {
+  const Deadline *deadline;
+  Time::time_point t_last;  // last clock read
+  int interval;
+  int count;
+
+  static double CHECK_PERIOD_US;
+  static constexpr int MAX_INTERVAL = 1 << 16;
+
+  DeadlineChecker(const Deadline *_deadline);
+  bool is_expired();
+};
+
+// memory manager, solvers account their large data structures here;
+// the numbers are approximations of the heap usage, not measurements
+struct MemoryBudget {
+  // degradation steps, the status only moves forward
+  enum Status { OK, DROP_EXPLORED, ROLLOUT, STOPPED };
+
+  const size_t limit;  // bytes, 0 -> unlimited
+  std::atomic<size_t> used;
+  std::atomic<size_t> peak;
+  std::atomic<int> status;
+
+  // Hyperparameters, fractions of the limit
+  static float DROP_EXPLORED_RATIO;
+  static float ROLLOUT_RATIO;
+
+  MemoryBudget(double _limit_mb = 0);
+  void allocate(size_t bytes);
+  void deallocate(size_t bytes);
+  size_t get_remaining() const;  // SIZE_MAX when unlimited
+  float get_usage() const;       // used / limit, 0 when unlimited
+  double used_mb() const;
+  double peak_mb() const;
+  void degrade(const Status s);
+  const char *get_status_name() const;
+};
+
+float get_memory_usage(const MemoryBudget *budget);
+bool is_exceeded(const MemoryBudget *budget);
+bool is_out_of_memory(const MemoryBudget *budget);  // the search is stopped
 
 float get_random_float(std::mt19937 &MT, float from = 0, float to = 1);
 float get_random_float(std::mt19937 *MT, float from = 0, float to = 1);
 int get_random_int(std::mt19937 &MT, int from = 0, int to = 1);
 int get_random_int(std::mt19937 *MT, int from = 0, int to = 1);
 
+// fast pseudo random number generators, both satisfy the requirements of
+// UniformRandomBitGenerator and can replace std::mt19937
+
+// xoshiro256++, c.f., https://prng.di.unimi.it/
+struct Xoshiro256pp {
+  using result_type = uint64_t;
+  std::array<uint64_t, 4> s;
+
+  Xoshiro256pp(uint64_t seed = 0);
+  static constexpr result_type min() { return 0; }
+  static constexpr result_type max() { return UINT64_MAX; }
+  inline result_type operator()()
+  {
+    const auto result = rotl(s[0] + s[3], 23) + s[0];
+    const auto t = s[1] << 17;
+    s[2] ^= s[0];
+    s[3] ^= s[1];
+    s[1] ^= s[2];
+    s[0] ^= s[3];
+    s[2] ^= t;
+    s[3] = rotl(s[3], 45);
+    return result;
+  }
+  static inline uint64_t rotl(const uint64_t x, int k)
+  {
+    return (x << k) | (x >> (64 - k));
+  }
+};
+
+uint64_t splitmix64(uint64_t &x);
+
+// peak resident set size of this process, 0 if unavailable
+double get_peak_memory_mb();
+
+// fork-join thread pool, the calling thread works as worker-0
+// note: run() must not be called concurrently from several threads
+struct ThreadPool {
+  const int num_threads;
+  std::vector<std::thread> workers;
+  std::mutex mtx;
+  std::condition_variable cv_start;
+  std::condition_variable cv_done;
+  const std::function<void(int, int)> *job;  // (task-id, worker-id)
+  int job_size;
+  std::atomic<int> next_task;
+  int num_busy;
+  uint generation;
+  bool stop;
+
+  ThreadPool(int _num_threads = 1);
+  ~ThreadPool();
+
+  // execute f(k, worker-id) for k = 0, ..., n - 1, then wait for all
+  void run(const int n, const std::function<void(int, int)> &f);
+  void work(const int worker_id);
+  void loop(const int worker_id);
+};
+
 template <typename Head, typename... Tail>
 void info(const int level, const int verbose, Head &&head, Tail &&...tail);
 
@@ -0,0 +1,125 @@
+#include "../include/decomposition.hpp"
+
+bool Decomposition::ENABLED = false;
+int Decomposition::MARGIN = 1;
+int Decomposition::NUM_THREADS = 4;
+
+// 以并查集合并区域相交的智能体，组按最小编号排序
+Decomposition::Decomposition(const Instance *_ins, DistTable *_D)
+    : ins(_ins), D(_D), groups(), mark(ins->G.size(), -1), stamp(0)
+{
+  const int N = ins->N;
+  auto parent = std::vector<int>(N);
+  std::iota(parent.begin(), parent.end(), 0);
+  auto find = [&](int i) {
+    while (parent[i] != i) i = parent[i] = parent[parent[i]];
+    return i;
+  };
+
+  // owner: an agent whose region contains the vertex
+  auto owner = std::vector<int>(ins->G.size(), -1);
+  for (auto i = 0; i < N; ++i) {
+    for (auto v : get_region(i)) {
+      if (owner[v] == -1) {
+        owner[v] = i;
+        continue;
+      }
+      const auto a = find(owner[v]), b = find(i);
+      if (a != b) parent[std::max(a, b)] = std::min(a, b);
+    }
+  }
+
+  auto group_index = std::vector<int>(N, -1);
+  for (auto i = 0; i < N; ++i) {
+    const auto r = find(i);
+    if (group_index[r] == -1) {
+      group_index[r] = groups.size();
+      groups.emplace_back();
+    }
+    groups[group_index[r]].push_back(i);
+  }
+}
+
+// 沿到目标距离递减的方向从起点展开得到最短路走廊，再向外扩展 MARGIN 步
+std::vector<int> Decomposition::get_region(const int i)
+{
+  ++stamp;
+  auto region = std::vector<int>{ins->starts[i]->id};
+  mark[region[0]] = stamp;
+  for (size_t k = 0; k < region.size(); ++k) {
+    const auto v = ins->G.V[region[k]];
+    const auto d = D->get(i, v);
+    if (d == 0) continue;
+    for (auto u : v->neighbors) {
+      if (mark[u->id] == stamp || D->get(i, u) != d - 1) continue;
+      mark[u->id] = stamp;
+      region.push_back(u->id);
+    }
+  }
+
+  // dilation
+  auto begin = size_t(0);
+  for (auto step = 0; step < MARGIN; ++step) {
+    const auto end = region.size();
+    for (auto k = begin; k < end; ++k) {
+      for (auto u : ins->G.V[region[k]]->neighbors) {
+        if (mark[u->id] == stamp) continue;
+        mark[u->id] = stamp;
+        region.push_back(u->id);
+      }
+    }
+    begin = end;
+  }
+  return region;
+}
+
+Solution Decomposition::solve(const int verbose, const Deadline *deadline,
+                              int seed, MemoryBudget *budget)
+{
+  const int K = groups.size();
+  auto largest = size_t(0);
+  for (auto &&group : groups) largest = std::max(largest, group.size());
+  info(1, verbose, deadline, "decomposition, groups: ", K,
+       ", largest: ", largest);
+  if (K <= 1) return Solution();
+
+  // solve groups on a thread pool, on the vertices and distances of ins
+  auto solutions = std::vector<Solution>(K);
+  auto pool = ThreadPool(std::min(NUM_THREADS, K));
+  pool.run(K, [&](int k, int) {
+    const auto sub = Instance(*ins, groups[k]);
+    auto D_sub = DistTable(*D, groups[k]);
+    auto lacam = LaCAM(&sub, &D_sub, verbose, deadline, seed, budget);
+    lacam.anytime = false;  // the rest of the time is for the joint fallback
+    solutions[k] = lacam.solve();
+  });
+
+  for (auto k = 0; k < K; ++k) {
+    if (!solutions[k].empty()) continue;
+    info(1, verbose, deadline, "decomposition, group ", k, " failed");
+    return Solution();
+  }
+  auto solution = merge(solutions);
+  if (!is_feasible_solution(*ins, solution)) {
+    info(1, verbose, deadline, "decomposition, groups collide");
+    return Solution();
+  }
+  return solution;
+}
+
+Solution Decomposition::merge(const std::vector<Solution> &solutions) const
+{
+  auto T = size_t(0);
+  for (auto &&solution : solutions) T = std::max(T, solution.size());
+  auto merged = Solution(T, Config(ins->N, nullptr));
+  for (size_t k = 0; k < groups.size(); ++k) {
+    auto &&solution = solutions[k];
+    for (size_t t = 0; t < T; ++t) {
+      auto &&Q = solution[std::min(t, solution.size() - 1)];
+      for (size_t j = 0; j < groups[k].size(); ++j) {
+        merged[t][groups[k][j]] = Q[j];
+      }
+    }
+  }
+  return merged;
+}
@@ -3,28 +3,67 @@
 bool DistTable::MULTI_THREAD_INIT = true;
 
 // 初始化距离表并调用 BFS 预处理。
-DistTable::DistTable(const Instance &ins)
-    : K(ins.G.V.size()), table(ins.N, std::vector<int>(K, K))
+DistTable::DistTable(const Instance &ins, const Deadline *deadline,
+                     const bool multi_thread)
+    : K(ins.G.V.size()),
+      table(ins.N, std::vector<int>(K, K)),
+      base(nullptr),
+      agents()
 {
-  setup(&ins);
+  setup(&ins, deadline, multi_thread);
 }
 
 // 初始化成员变量，并调用 setup 方法完成距离表的预处理。
-DistTable::DistTable(const Instance *ins)
-    : K(ins->G.V.size()), table(ins->N, std::vector<int>(K, K))
+DistTable::DistTable(const Instance *ins, const Deadline *deadline,
+                     const bool multi_thread)
+    : K(ins->G.V.size()),
+      table(ins->N, std::vector<int>(K, K)),
+      base(nullptr),
+      agents()
 {
-  setup(ins);
+  setup(ins, deadline, multi_thread);
+}
+
+// 从 base 中借用部分智能体的行（交换，不复制），析构时归还
+DistTable::DistTable(DistTable &_base, const std::vector<int> &_agents)
+    : K(_base.K),
+      table(_agents.size()),
+      OPEN(_base.OPEN.empty() ? 0 : _agents.size()),
+      base(&_base),
+      agents(_agents)
+{
+  for (size_t k = 0; k < agents.size(); ++k) {
+    table[k].swap(base->table[agents[k]]);
+    if (!OPEN.empty()) OPEN[k].swap(base->OPEN[agents[k]]);
+  }
+}
+
+DistTable::~DistTable()
+{
+  if (base == nullptr) return;
+  for (size_t k = 0; k < agents.size(); ++k) {
+    table[k].swap(base->table[agents[k]]);
+    if (!OPEN.empty()) OPEN[k].swap(base->OPEN[agents[k]]);
+  }
 }
 
 // 为每个目标点做一次图的多源广度优先搜索（BFS），以预先计算每个节点到各目标点的最短距离。方法支持多线程并发初始化和单线程惰性初始化两种方式.
-void DistTable::setup(const Instance *ins)
+void DistTable::setup(const Instance *ins, const Deadline *deadline,
+                      const bool multi_thread)
 {
-  if (MULTI_THREAD_INIT) {
+  if (multi_thread) {
+    // queues of BFS interrupted by the deadline, continued lazily
+    auto interrupted = std::vector<std::queue<Vertex *>>(ins->N);
     auto bfs = [&](const int i) {
       auto g_i = ins->goals[i];
       auto Q = std::queue<Vertex *>({g_i});
+      auto checker = DeadlineChecker(deadline);
       table[i][g_i->id] = 0;
       while (!Q.empty()) {
+        if (checker.is_expired()) {
+          interrupted[i] = std::move(Q);
+          return;
+        }
         auto n = Q.front();
         Q.pop();
         const int d_n = table[i][n->id];
@@ -41,6 +80,12 @@ void DistTable::setup(const Instance *ins)
     for (size_t i = 0; i < ins->N; ++i) {
       pool.emplace_back(std::async(std::launch::async, bfs, i));
     }
+    for (auto &&f : pool) f.wait();
+    for (auto &&Q : interrupted) {
+      if (Q.empty()) continue;
+      OPEN = std::move(interrupted);
+      break;
+    }
   } else {
     // lazy BFS
     for (size_t i = 0; i < ins->N; ++i) {
@@ -66,7 +111,7 @@ int DistTable::get(const int i, const int v_id)
    */
 
   while (!OPEN[i].empty()) {
-    auto &&n = OPEN[i].front();
+    auto n = OPEN[i].front();
     OPEN[i].pop();
     const int d_n = table[i][n->id];
     for (auto &&m : n->neighbors) {
@@ -81,3 +126,10 @@ int DistTable::get(const int i, const int v_id)
 }
 
 int DistTable::get(const int i, const Vertex *v) { return get(i, v->id); }
+
+// 距离表本身与每个智能体的 BFS 队列（队列按 deque 的初始块估计）
+size_t DistTable::memory_usage() const
+{
+  return table.size() * (K * sizeof(int) + sizeof(std::vector<int>)) +
+         OPEN.size() * (sizeof(std::queue<Vertex *>) + 512);
+}
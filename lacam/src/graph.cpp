@@ -5,12 +5,17 @@ Vertex::Vertex(int _id, int _index, int _x, int _y)
 {
 }
 
-Graph::Graph(int w, int h) : V(), U(w * h, nullptr), width(w), height(h) {}
+Graph::Graph(int w, int h)
+    : V(), U(w * h, nullptr), width(w), height(h), owner(true)
+{
+}
 
 Graph::~Graph()
 {
-  for (auto &v : V)
-    if (v != nullptr) delete v;
+  if (owner) {
+    for (auto &v : V)
+      if (v != nullptr) delete v;
+  }
   V.clear();
 }
 
@@ -19,7 +24,8 @@ static const std::regex r_height = std::regex(R"(height\s(\d+))");
 static const std::regex r_width = std::regex(R"(width\s(\d+))");
 static const std::regex r_map = std::regex(R"(map)");
 
-Graph::Graph(const std::string &filename) : V(Vertices()), width(0), height(0)
+Graph::Graph(const std::string &filename)
+    : V(Vertices()), width(0), height(0), owner(true)
 {
   std::ifstream file(filename);
   if (!file) {
@@ -93,6 +99,66 @@ Graph::Graph(const std::string &filename) : V(Vertices()), width(0), height(0)
   }
 }
 
+// 复制顶点并按 id 重建邻接关系，动作顺序与原图一致
+Graph::Graph(const Graph &G)
+    : V(), U(G.U.size(), nullptr), width(G.width), height(G.height), owner(true)
+{
+  for (auto v : G.V) {
+    V.push_back(new Vertex(v->id, v->index, v->x, v->y));
+    U[v->index] = V.back();
+  }
+  for (auto v : G.V) {
+    auto &&u = V[v->id];
+    for (auto w : v->neighbors) u->neighbors.push_back(V[w->id]);
+    for (auto w : v->actions) u->actions.push_back(V[w->id]);
+  }
+}
+
+// 共享原图的顶点，不复制邻接关系
+Graph::Graph(const Graph *G)
+    : V(G->V), U(G->U), width(G->width), height(G->height), owner(false)
+{
+}
+
+// 诱导子图：只保留两端都在 vertex_ids 中的边，U 仅覆盖包围盒
+Graph::Graph(const Graph &G, const std::vector<int> &vertex_ids)
+    : V(), U(), width(0), height(0), owner(true)
+{
+  if (vertex_ids.empty()) return;
+  auto x0 = INT_MAX, y0 = INT_MAX, x1 = INT_MIN, y1 = INT_MIN;
+  for (auto k : vertex_ids) {
+    const auto v = G.V[k];
+    x0 = std::min(x0, v->x);
+    y0 = std::min(y0, v->y);
+    x1 = std::max(x1, v->x);
+    y1 = std::max(y1, v->y);
+  }
+  width = x1 - x0 + 1;
+  height = y1 - y0 + 1;
+  U.assign(width * height, nullptr);
+  for (auto k : vertex_ids) {
+    const auto v = G.V[k];
+    const auto index = width * (v->y - y0) + (v->x - x0);
+    V.push_back(new Vertex(V.size(), index, v->x - x0, v->y - y0));
+    U[index] = V.back();
+  }
+  auto get_local = [&](const Vertex *w) -> Vertex * {
+    if (w->x < x0 || w->x > x1 || w->y < y0 || w->y > y1) return nullptr;
+    return U[width * (w->y - y0) + (w->x - x0)];
+  };
+  for (size_t k = 0; k < vertex_ids.size(); ++k) {
+    const auto v = G.V[vertex_ids[k]];
+    for (auto w : v->neighbors) {
+      auto u = get_local(w);
+      if (u != nullptr) V[k]->neighbors.push_back(u);
+    }
+    for (auto w : v->actions) {
+      auto u = get_local(w);
+      if (u != nullptr) V[k]->actions.push_back(u);
+    }
+  }
+}
+
 int Graph::size() const { return V.size(); }
 
 void Graph::save(const std::string &output_name) const
@@ -150,6 +216,29 @@ uint ConfigHasher::operator()(const Config &C) const
   return hash;
 }
 
+uint64_t get_agent_hash(const int i, const Vertex *v)
+{
+  auto x = ((uint64_t)i << 32) | (uint32_t)v->id;
+  return splitmix64(x);
+}
+
+uint64_t get_config_hash(const Config &C)
+{
+  uint64_t hash = 0;
+  for (size_t i = 0; i < C.size(); ++i) hash ^= get_agent_hash(i, C[i]);
+  return hash;
+}
+
+uint64_t get_config_hash(uint64_t hash_from, const Config &C_from,
+                         const Config &C_to)
+{
+  for (size_t i = 0; i < C_to.size(); ++i) {
+    if (C_from[i] == C_to[i]) continue;
+    hash_from ^= get_agent_hash(i, C_from[i]) ^ get_agent_hash(i, C_to[i]);
+  }
+  return hash_from;
+}
+
 std::ostream &operator<<(std::ostream &os, const Vertex *v)
 {
   os << v->index;
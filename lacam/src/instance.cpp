@@ -14,6 +14,24 @@ Instance::Instance(const std::string &map_filename,
   for (auto k : goal_indexes) goals.push_back(G.U[k]);
 }
 
+Instance::Instance(const Instance &ins, const std::vector<int> &agents)
+    : G(&ins.G), starts(Config()), goals(Config()), N(agents.size())
+{
+  for (auto i : agents) {
+    starts.push_back(ins.starts[i]);
+    goals.push_back(ins.goals[i]);
+  }
+}
+
+Instance::Instance(const Graph &_G, const std::vector<int> &vertex_ids,
+                   const std::vector<int> &start_ids,
+                   const std::vector<int> &goal_ids)
+    : G(_G, vertex_ids), starts(Config()), goals(Config()), N(start_ids.size())
+{
+  for (auto k : start_ids) starts.push_back(G.V[k]);
+  for (auto k : goal_ids) goals.push_back(G.V[k]);
+}
+
 // for load instance
 static const std::regex r_instance =
     std::regex(R"(\d+\t.+\.map\t\d+\t\d+\t(\d+)\t(\d+)\t(\d+)\t(\d+)\t.+)");
@@ -1,96 +1,526 @@
 #include "../include/lacam.hpp"
 
 bool LaCAM::ANYTIME = false;
+int LaCAM::BATCH_SIZE = 1;
+int HNode::FULL_CONFIG_INTERVAL = 1;
 float LaCAM::RANDOM_INSERT_PROB1 = 0.001;
 float LaCAM::RANDOM_INSERT_PROB2 = 0.001;
+std::string LaCAM::SPILL_DIR = "";
+std::string LaCAM::CHECKPOINT_FILE = "";
+double LaCAM::CHECKPOINT_INTERVAL_MS = 60000;
+std::string LaCAM::RESUME_FILE = "";
 
 // 函数对象（仿函数）的比较运算符，专门用来比较两个HNode*（指向HNode结构的指针）的“大小”。
+// 先比较哈希值，仅在哈希冲突时比较完整配置
 bool CompareHNodePointers::operator()(const HNode *l, const HNode *r) const
 {
-  const auto N = l->Q.size();
+  if (l->hash != r->hash) return l->hash < r->hash;
+  if (l == r) return false;
+  const auto Q_l = l->get_config();
+  const auto Q_r = r->get_config();
+  const auto N = Q_l.size();
   for (size_t i = 0; i < N; ++i) {
-    if (l->Q[i] != r->Q[i]) return l->Q[i]->id < r->Q[i]->id;
+    if (Q_l[i] != Q_r[i]) return Q_l[i]->id < Q_r[i]->id;
   }
   return false;
 }
 
+HNodeExpansion::HNodeExpansion(const std::vector<Priority> &_priorities)
+    : priorities(_priorities),
+      order(),
+      num_active(0),
+      search_tree(1),
+      cursor_node(0),
+      cursor_action(-1),
+      exhausted(false),
+      num_in_flight(0)
+{
+}
+
+size_t HNodeExpansion::memory_usage() const
+{
+  return sizeof(HNodeExpansion) + priorities.size() * sizeof(Priority) +
+         order.capacity() * sizeof(int) + search_tree.size() * sizeof(LNode);
+}
+
+SolutionHandle::SolutionHandle() : solution(), cost(-1), version(0) {}
+
+void SolutionHandle::update(const Solution &_solution, const int _cost)
+{
+  {
+    std::lock_guard<std::mutex> lock(mtx);
+    solution = _solution;
+    cost = _cost;
+    ++version;
+  }
+  cv.notify_all();
+}
+
+int SolutionHandle::get(Solution &_solution) const
+{
+  std::lock_guard<std::mutex> lock(mtx);
+  _solution = solution;
+  return version;
+}
+
+int SolutionHandle::get_cost() const
+{
+  std::lock_guard<std::mutex> lock(mtx);
+  return cost;
+}
+
+int SolutionHandle::wait(const int known_version, const double timeout_ms)
+{
+  std::unique_lock<std::mutex> lock(mtx);
+  cv.wait_for(lock, std::chrono::duration<double, std::milli>(timeout_ms),
+              [&] { return version > known_version; });
+  return version;
+}
+
+ImproveCallback SolutionHandle::get_callback()
+{
+  return [this](const Solution &_solution, const int _cost) {
+    update(_solution, _cost);
+  };
+}
+
 //  HNode 类的构造函数，主要作用是基于给定的参数（配置、距离表、父节点、代价等）初始化一个新的搜索树节点。
-HNode::HNode(Config _Q, DistTable *D, HNode *_parent, int _g, int _h)
-    : Q(_Q),
+HNode::HNode(const Config &_Q, DistTable *D, HNode *_parent, int _g, int _h,
+             const std::vector<int> *activated, const Config *C_parent)
+    : hash(0),
+      delta_base(_parent != nullptr && FULL_CONFIG_INTERVAL > 1 &&
+                         (_parent->delta_len + 1) % FULL_CONFIG_INTERVAL != 0
+                     ? _parent
+                     : nullptr),
+      Q(delta_base == nullptr ? _Q : Config()),
+      Q_diff(),
+      diff_dense(false),
+      delta_len(delta_base == nullptr ? 0 : delta_base->delta_len + 1),
+      spill_file(nullptr),
+      spill_offset(0),
       parent(_parent),
+      open_index(-1),
       neighbors(),
       g(_g),
       h(_h),
       f(g + h),
       depth(parent == nullptr ? 0 : parent->depth + 1),
-      priorities(Q.size()),
-      order(Q.size(), 0),
-      search_tree()
-{
-  if (parent != nullptr) parent->neighbors.insert(this);
-  search_tree.push(new LNode());
-  const int N = Q.size();
-  for (int i = 0; i < N; ++i) {
-    // set priorities
-    if (parent == nullptr) {
-      // initialize
-      priorities[i] = (float)D->get(i, Q[i]) / 10000;
+      expansion(std::make_unique<HNodeExpansion>(
+          parent == nullptr ? std::vector<Priority>(_Q.size())
+                            : parent->expansion->priorities))
+{
+  const int N = _Q.size();
+  auto &&priorities = expansion->priorities;
+  auto &&order = expansion->order;
+
+  // configuration
+  auto Q_parent = Config();
+  if (parent != nullptr && C_parent == nullptr) {
+    Q_parent = parent->get_config();
+    C_parent = &Q_parent;
+  }
+  if (parent == nullptr) {
+    hash = get_config_hash(_Q);
+  } else {
+    hash = get_config_hash(parent->hash, *C_parent, _Q);
+  }
+  if (delta_base != nullptr) {
+    auto get_action = [&](int i) -> uint32_t {
+      auto &&A = (*C_parent)[i]->actions;
+      return std::find(A.begin(), A.end(), _Q[i]) - A.begin();
+    };
+    auto num_moved = 0;
+    for (int i = 0; i < N; ++i) num_moved += (_Q[i] != (*C_parent)[i]);
+    diff_dense = num_moved * 8 >= N;
+    if (diff_dense) {
+      Q_diff.assign((N + 7) / 8, 0);
+      for (int i = 0; i < N; ++i) Q_diff[i / 8] |= get_action(i) << (i % 8 * 4);
     } else {
-      // dynamic priorities, akin to PIBT
-      if (D->get(i, Q[i]) != 0) {
-        priorities[i] = parent->priorities[i] + 1;
-      } else {
-        priorities[i] = parent->priorities[i] - (int)parent->priorities[i];
+      Q_diff.reserve(num_moved);
+      for (int i = 0; i < N; ++i) {
+        if (_Q[i] != (*C_parent)[i]) Q_diff.push_back(i << 3 | get_action(i));
       }
     }
   }
 
-  // set order
-  auto cmp = [&](int i, int j) { return priorities[i] > priorities[j]; };
-  std::iota(order.begin(), order.end(), 0);
-  std::sort(order.begin(), order.end(), cmp);
+  if (parent == nullptr) {
+    // initialize
+    for (int i = 0; i < N; ++i) {
+      const auto d = D->get(i, _Q[i]);
+      priorities[i] = d;
+      if (d != 0) order.push_back(i);
+    }
+    auto cmp = [&](int i, int j) {
+      return has_higher_priority(priorities, i, j);
+    };
+    std::sort(order.begin(), order.end(), cmp);
+  } else {
+    // dynamic priorities, akin to PIBT;
+    // the order is merged from the parent's one in linear time
+    auto changed = std::vector<int>();
+    if (activated == nullptr) {
+      for (int i = 0; i < N; ++i) {
+        if (_Q[i] != (*C_parent)[i] && D->get(i, (*C_parent)[i]) == 0) {
+          changed.push_back(i);
+        }
+      }
+      activated = &changed;
+    }
+    const auto prev = parent->expansion->order.data();
+    // settled agents are appended by complete_order only when needed
+    order.reserve(parent->expansion->num_active + activated->size());
+    update_active_order(
+        prev, prev + parent->expansion->num_active, *activated,
+        [&](const int i) { return D->get(i, _Q[i]) != 0; }, priorities, order);
+  }
+  expansion->num_active = order.size();
 }
 
-// 确保内存安全地释放 search_tree 队列中的所有动态分配对象，防止内存泄漏。
-HNode::~HNode()
+HNode::HNode(const Config &_Q, int _g, int _h, int _depth)
+    : hash(get_config_hash(_Q)),
+      delta_base(nullptr),
+      Q(_Q),
+      Q_diff(),
+      diff_dense(false),
+      delta_len(0),
+      spill_file(nullptr),
+      spill_offset(0),
+      parent(nullptr),
+      open_index(-1),
+      neighbors(),
+      g(_g),
+      h(_h),
+      f(g + h),
+      depth(_depth),
+      expansion(nullptr)
 {
-  while (!search_tree.empty()) {
-    delete search_tree.front();
-    search_tree.pop();
+}
+
+HNode::~HNode() {}
+
+Config HNode::get_config() const
+{
+  if (delta_base == nullptr && !is_spilled()) return Q;
+  auto C = Config();
+  ConfigCache(0).materialize(this, C);
+  return C;
+}
+
+void HNode::apply_diff(Config &C) const
+{
+  if (diff_dense) {
+    for (size_t i = 0; i < C.size(); ++i) {
+      C[i] = C[i]->actions[(Q_diff[i / 8] >> (i % 8 * 4)) & 0xf];
+    }
+  } else {
+    for (auto e : Q_diff) C[e >> 3] = C[e >> 3]->actions[e & 7];
+  }
+}
+
+ConfigCache::ConfigCache(int size)
+    : nodes(size, nullptr), configs(size), next(0), scratch(), chain()
+{
+}
+
+const Config &ConfigCache::get(const HNode *H, const bool keep)
+{
+  if (H->delta_base == nullptr && !H->is_spilled()) return H->Q;
+  for (size_t k = 0; k < nodes.size(); ++k) {
+    if (nodes[k] == H) return configs[k];
+  }
+  if (!keep || nodes.empty()) {
+    materialize(H, scratch);
+    return scratch;
+  }
+  const auto k = next;
+  next = (next + 1) % nodes.size();
+  materialize(H, configs[k]);
+  nodes[k] = H;
+  return configs[k];
+}
+
+bool ConfigCache::is_same(const HNode *H, const Config &C)
+{
+  return is_same_config(get(H, false), C);
+}
+
+// 沿 delta_base 向上找到完整存储（内存或磁盘）或已缓存的配置，再依次应用差分
+void ConfigCache::materialize(const HNode *H, Config &C)
+{
+  chain.clear();
+  const Config *base = nullptr;
+  for (auto n = H;; n = n->delta_base) {
+    if (n->delta_base == nullptr && !n->is_spilled()) {
+      base = &n->Q;
+      break;
+    }
+    for (size_t k = 0; k < nodes.size(); ++k) {
+      if (nodes[k] == n) base = &configs[k];
+    }
+    if (base != nullptr) break;
+    if (n->delta_base == nullptr) {
+      n->spill_file->read(n->spill_offset, C);
+      break;
+    }
+    chain.push_back(n);
+  }
+  if (base != nullptr) C = *base;
+  for (auto itr = chain.rbegin(); itr != chain.rend(); ++itr) {
+    (*itr)->apply_diff(C);
+  }
+}
+
+// 按 BFS 顺序按需生成下一个约束；子约束的动作顺序在弹出时随机化，不修改共享的 Graph
+LNode *HNode::pop_constraint(const Config &C, std::mt19937 &MT)
+{
+  if (expansion == nullptr) return nullptr;
+  auto &&E = *expansion;
+  if (E.exhausted) return nullptr;
+
+  LNode *L;
+  if (E.cursor_action < 0) {
+    L = &E.search_tree.front();  // root, no constraints
+    E.cursor_action = 0;
+  } else {
+    // skip nodes whose children are all generated
+    while (E.cursor_node < E.search_tree.size() &&
+           E.cursor_action >= E.search_tree[E.cursor_node].num_children) {
+      ++E.cursor_node;
+      E.cursor_action = 0;
+    }
+    if (E.cursor_node == E.search_tree.size()) {
+      E.exhausted = true;
+      return nullptr;
+    }
+    const auto &P = E.search_tree[E.cursor_node];
+    const auto i = E.order[P.depth];
+    const auto depth = P.depth + 1;
+    auto v = C[i]->actions[P.perm[E.cursor_action++]];
+    E.search_tree.emplace_back(E.cursor_node, depth, i, v);
+    L = &E.search_tree.back();
   }
+
+  if (L->depth < C.size()) {
+    if (L->depth >= E.order.size()) complete_order();
+    const auto K = C[E.order[L->depth]]->actions.size();
+    for (size_t k = 0; k < K; ++k) L->perm[k] = k;
+    std::shuffle(L->perm.begin(), L->perm.begin() + K, MT);  // randomize
+    L->num_children = K;
+  }
+  return L;
 }
 
-//  LNode 类的默认构造函数，其作用是初始化 LNode 类的成员变量。
-LNode::LNode() : who(), where(), depth(0) {}
+// 补全 order：将停在目标上的智能体按优先级排在活跃智能体之后
+void HNode::complete_order()
+{
+  const int N = expansion->priorities.size();
+  auto &&order = expansion->order;
+  if ((int)order.size() == N) return;
+  auto is_active = std::vector<bool>(N, false);
+  for (auto i : order) is_active[i] = true;
+  for (auto i = 0; i < N; ++i) {
+    if (!is_active[i]) order.push_back(i);
+  }
+  auto cmp = [&](int i, int j) {
+    return has_higher_priority(expansion->priorities, i, j);
+  };
+  std::sort(order.begin() + expansion->num_active, order.end(), cmp);
+}
 
-// 根据给定的父节点、一个整数和一个顶点指针，构造新的 LNode 对象。
-LNode::LNode(LNode *parent, int i, Vertex *v)
-    : who(parent->who), where(parent->where), depth(parent->depth + 1)
+// 沿父节点回溯，写出全部约束
+void HNode::get_constraints(const LNode *L, Config &Q_to,
+                            std::vector<int> &agents) const
+{
+  agents.resize(L->depth);
+  for (; L->parent >= 0; L = &expansion->search_tree[L->parent]) {
+    Q_to[L->who] = L->where;
+    agents[L->depth - 1] = L->who;
+  }
+}
+
+Solution backtrack(const HNode *H)
+{
+  auto solution = Solution();
+  for (; H != nullptr; H = H->parent) solution.push_back(H->get_config());
+  std::reverse(solution.begin(), solution.end());
+  return solution;
+}
+
+// 低层搜索结束后释放展开状态，只保留查重与回溯所需的部分
+void HNode::release() { expansion.reset(); }
+
+// 已释放节点的完整配置写入磁盘，内存中只保留偏移
+bool HNode::spill(SpillFile &file)
+{
+  if (expansion != nullptr || delta_base != nullptr || spill_file != nullptr) {
+    return true;
+  }
+  if (!file.append(hash, Q, spill_offset)) return false;
+  spill_file = &file;
+  Config().swap(Q);
+  return true;
+}
+
+bool HNode::is_spilled() const { return spill_file != nullptr; }
+
+size_t HNode::memory_usage() const
+{
+  auto bytes = sizeof(HNode) + Q.size() * sizeof(Vertex *) +
+               Q_diff.size() * sizeof(uint32_t);
+  if (expansion != nullptr) bytes += expansion->memory_usage();
+  return bytes;
+}
+
+//  LNode 类的默认构造函数，即不含约束的根节点。
+LNode::LNode()
+    : parent(-1),
+      who(-1),
+      where(nullptr),
+      depth(0),
+      num_children(0),
+      perm()
+{
+}
+
+// 根据父节点下标、深度、一个整数和一个顶点指针，构造新的 LNode 对象。
+LNode::LNode(int _parent, uint _depth, int i, Vertex *v)
+    : parent(_parent),
+      who(i),
+      where(v),
+      depth(_depth),
+      num_children(0),
+      perm()
 {
-  who.push_back(i);
-  where.push_back(v);
 }
 
 LNode::~LNode(){};
 
+OpenList::OpenList() : nodes(), num_nodes(0), num_tombstones(0) {}
+
+OpenList::~OpenList() {}
+
+bool OpenList::empty() const { return num_nodes == 0; }
+
+size_t OpenList::size() const { return num_nodes; }
+
+HNode *OpenList::front() const { return nodes.back(); }
+
+// 已在 OPEN 中的节点移到表头，原位置留下墓碑而不是重复插入
+void OpenList::push_front(HNode *H)
+{
+  if (H->open_index >= 0) {
+    if (H->open_index == (int)nodes.size() - 1) return;  // already front
+    nodes[H->open_index] = nullptr;
+    ++num_tombstones;
+  } else {
+    ++num_nodes;
+  }
+  H->open_index = nodes.size();
+  nodes.push_back(H);
+  if (num_tombstones > num_nodes) compact();
+}
+
+void OpenList::pop_front()
+{
+  nodes.back()->open_index = -1;
+  nodes.pop_back();
+  --num_nodes;
+  // keep the front valid
+  while (!nodes.empty() && nodes.back() == nullptr) {
+    nodes.pop_back();
+    --num_tombstones;
+  }
+}
+
+// 拒绝采样：墓碑不超过节点数，期望尝试次数不超过两次
+HNode *OpenList::get_random(std::mt19937 &MT) const
+{
+  while (true) {
+    auto H = nodes[get_random_int(MT, 0, nodes.size() - 1)];
+    if (H != nullptr) return H;
+  }
+}
+
+void OpenList::compact()
+{
+  size_t k = 0;
+  for (auto H : nodes) {
+    if (H == nullptr) continue;
+    H->open_index = k;
+    nodes[k++] = H;
+  }
+  nodes.resize(k);
+  num_tombstones = 0;
+}
+
 // 初始化 LaCAM 类的成员变量，为后续算法运行做准备。
 LaCAM::LaCAM(const Instance *_ins, DistTable *_D, int _verbose,
-             const Deadline *_deadline, int _seed)
+             const Deadline *_deadline, int _seed,
+             MemoryBudget *_budget, const ImproveCallback &_on_improve)
     : ins(_ins),
       D(_D),
       deadline(_deadline),
+      deadline_checker(deadline),
       seed(_seed),
       MT(seed),
       rrd(0, 1),
       verbose(_verbose),
+      budget(_budget),
+      on_improve(_on_improve),
       pibt(ins, D, seed),
+      config_cache(),
+      EXPLORED(),
+      GC_HNodes(),
+      H_init(nullptr),
+      goal_hash(get_config_hash(ins->goals)),
       H_goal(nullptr),
       OPEN(),
-      loop_cnt(0)
+      loop_cnt(0),
+      constrained_agents(),
+      accounted(0),
+      open_bytes(0),
+      memory_status(MemoryBudget::OK),
+      rollout_solution(),
+      spill_file(),
+      last_checkpoint_ms(0),
+      finished(false),
+      anytime(ANYTIME),
+      checkpoint_file(CHECKPOINT_FILE),
+      resume_file(RESUME_FILE),
+      batch_pool(),
+      batch_pibts(),
+      batch_Q(),
+      batch_C(),
+      batch_res()
 {
+  if (BATCH_SIZE > 1 && !D->OPEN.empty()) {
+    // lazy BFS is not thread-safe
+    warn("batched expansion requires pre-computed distance tables");
+  } else if (BATCH_SIZE > 1) {
+    batch_pool = std::make_unique<ThreadPool>(BATCH_SIZE);
+    batch_pibts.reserve(BATCH_SIZE - 1);
+    for (auto k = 1; k < BATCH_SIZE; ++k) {
+      batch_pibts.emplace_back(ins, D, seed + k, 1);  // no nested thread pools
+    }
+    batch_Q.assign(BATCH_SIZE, Config(ins->N, nullptr));
+    batch_C.resize(BATCH_SIZE);
+    batch_res.resize(BATCH_SIZE);
+  }
+  if (!SPILL_DIR.empty()) {
+    spill_file = std::make_unique<SpillFile>(&ins->G, ins->N, SPILL_DIR);
+    if (!spill_file->is_open()) {
+      warn("failed to create a spill file in ", SPILL_DIR);
+      spill_file.reset();
+    }
+  }
 }
 
-LaCAM::~LaCAM() {}
+// 清理所有动态分配的高层节点，防止内存泄漏。
+LaCAM::~LaCAM()
+{
+  for (auto &&H : GC_HNodes) delete H;  // memory management
+  deallocate(accounted);
+}
 
 // 在给定的时间限制内，为所有智能体从起点到终点找到一组可行（或最优）的路径方案。
 Solution LaCAM::solve()
@@ -99,184 +529,18 @@ Solution LaCAM::solve()
   solver_info(1, "LaCAM begins");
 
   // setup search
-  // 用于记录已经探索过的配置（哈希表，避免重复扩展）。
-  auto EXPLORED = std::unordered_map<Config, HNode *, ConfigHasher>();
-  HNodes GC_HNodes; // 用于后续内存回收，保存所有高层节点指针。
-
-  // insert initial node
-  // 3: Open.push(Ninit); Explored[S] = Ninit
-  auto H_init = new HNode(ins->starts, D); // 新建一个以起点为内容的高层节点H_init。
-  OPEN.push_front(H_init); // 将其插入OPEN表（待扩展节点队列）。
-  EXPLORED[H_init->Q] = H_init; // 标记为已探索，且加入垃圾回收管理队列。
-  GC_HNodes.push_back(H_init);
+  init();
 
   // search loop
   // 主搜索循环
   solver_info(2, "search iteration begins");
   // 只要OPEN表不空，且没有超时，循环继续。
   // 4: while Open= ∅ do
-  while (!OPEN.empty() && !is_expired(deadline))
-  {
-    ++loop_cnt;
-
-    // random insert
-    // Anytime mode: 在找到一个可行解后，增加多样性（random restart/插入），利用概率在 OPEN 表头插入初始节点或其他随机节点。
-    if (H_goal != nullptr)
-    {
-      auto r = rrd(MT);
-      if (r < RANDOM_INSERT_PROB2 / 2)
-      {
-        OPEN.push_front(H_init);
-      }
-      else if (r < RANDOM_INSERT_PROB2)
-      {
-        auto H = OPEN[get_random_int(MT, 0, OPEN.size() - 1)];
-        OPEN.push_front(H);
-      }
-    }
-
-    // do not pop here!
-    // 5: N ←Open.top()
-    // 取 OPEN 表头节点（注意：这里只取不弹，后面有条件才弹）。
-    auto H = OPEN.front();  // high-level node
-
-    // check uppwer bounds
-    // 如果当前已找到目标（H_goal非空），且当前节点 g 值不优于已知目标，则剪枝并把初始节点重新加入 OPEN，跳过当前分支。
-    if (H_goal != nullptr && H->g >= H_goal->g)
-    {
-      OPEN.pop_front();
-      solver_info(5, "prune, g=", H->g, " >= ", H_goal->g);
-      OPEN.push_front(H_init);
-      continue;
-    }
-
-    // check goal condition
-    // 6: if N.config = G then return backtrack(N)
-    // 如果是第一次到达所有agent目标，则设置H_goal。在非anytime模式下，找到后直接退出。
-    if (H_goal == nullptr && is_same_config(H->Q, ins->goals))
-    {
-      H_goal = H;
-      solver_info(2, "found solution, g=", H->g, ", depth=", H->depth);
-      if (!ANYTIME) break;
-      continue;
-    }
-
-    // extract constraints
-    // 7: if N.tree = ∅ then Open.pop(); continue
-    // 若当前高层节点 search tree 为空，无子节点可扩展，则弹出 OPEN 并跳过。
-    if (H->search_tree.empty())
-    {
-      OPEN.pop_front();
-      continue;
-    }
-    // 8: C ←N.tree.pop()
-    auto L = H->search_tree.front();
-    H->search_tree.pop();
-
-    // low level search
-    // 9: if depth(C) ≤ |A| then
-    // 扩展当前节点的低层树，随机化动作，逐步推进各智能体的动作组合（类似多队列 BFS 或多智能体交替扩展）。
-    if (L->depth < H->Q.size())
-    {
-      // 10: i←N.order[depth(C)]; v ← N.config[i]
-      const auto i = H->order[L->depth];
-      auto &&C = H->Q[i]->actions;
-      std::shuffle(C.begin(), C.end(), MT);  // randomize
-      // 11: foru∈neigh(v)∪{v}do
-      // 12:  Cnew←⟨parent :C,who :i,where : u⟩
-      // 13: N.tree.push(Cnew)
-      for (auto u : C) H->search_tree.push(new LNode(L, i, u));
-    }
-
-    // create successors at the high-level search
-    // 14:  Qnew ←get new config(N,C)
-    // 生成新配置Q_to。
-    auto Q_to = Config(ins->N, nullptr);
-    // 验证有效后（set_new_config），生成新的高层节点。
-    auto res = set_new_config(H, L, Q_to);
-    delete L;
-    if (!res) continue;
-
-    // check explored list
-    auto iter = EXPLORED.find(Q_to);
-    // 如果新配置没被探索过，则新建高层节点，推进到OPEN和EXPLORED。
-    if (iter == EXPLORED.end())
-    {
-      // new one -> insert
-      // 18: Open.push(Nnew); Explored[Qnew] = Nnew
-      auto H_new = new HNode(Q_to, D, H, get_g_val(H, Q_to), get_h_val(Q_to));
-      OPEN.push_front(H_new);
-      EXPLORED[H_new->Q] = H_new;
-      GC_HNodes.push_back(H_new);
-    }
-    // 如果已经探索过，同步旧信息并根据概率插入不同类型的节点（增强搜索覆盖）。
-    else
-    {
-      // known configuration
-      auto H_known = iter->second;
-      rewrite(H, H_known);
-
-      if (rrd(MT) >= RANDOM_INSERT_PROB1)
-      {
-        OPEN.push_front(iter->second);  // usual
-      }
-      else
-      {
-        solver_info(3, "random restart");
-        OPEN.push_front(H_init);  // sometimes
-      }
-    }
+  while (step(INT_MAX)) {
   }
 
-  // backtrack
-  // 从终点H_goal开始，逐步追溯回父节点，重建整个路径，最终逆序得到从起点到终点的完整解。
-  Solution solution;
-  {
-    auto H = H_goal;
-    while (H != nullptr)
-    {
-      solution.push_back(H->Q);
-      H = H->parent;
-    }
-    std::reverse(solution.begin(), solution.end());
-  }
-
-  // solution
-  if (solution.empty())
-  {
-    // 若无解且OPEN空，说明无解。
-    if (OPEN.empty())
-    {
-      solver_info(2, "fin. unsolvable instance");
-    }
-    // 若走到时间限制，则表示未找到解。
-    else
-    {
-      solver_info(2, "fin. reach time limit");
-    }
-  }
-  else
-  {
-    // 若找到解并OPEN空，表示最优解；
-    if (OPEN.empty())
-    {
-      solver_info(2, "fin. optimal solution, g=", H_goal->g,
-                  ", depth=", H_goal->depth);
-    }
-    // 否则可能是次优或抢先解。
-    else
-    {
-      solver_info(2, "fin. suboptimal solution, g=", H_goal->g,
-                  ", depth=", H_goal->depth);
-    }
-  }
-
-  // end processing
-  // 清理所有动态分配的高层节点，防止内存泄漏。
-  for (auto &&H : GC_HNodes) delete H;  // memory management
-
   // 返回搜索到的solution路径（一个多步配置的数组，每个元素代表某一步所有智能体的联合状态）。
-  return solution;
+  return result();
 }
 
 // 融合了beam search的方法
@@ -293,135 +557,234 @@ Solution LaCAM::solve_beam()
   solver_info(1, "LaCAM begins");
 
   // setup search
-  // 用于记录已经探索过的配置（哈希表，避免重复扩展）。
-  auto EXPLORED = std::unordered_map<Config, HNode *, ConfigHasher>();
-  HNodes GC_HNodes; // 用于后续内存回收，保存所有高层节点指针。
-
-  // insert initial node
-  auto H_init = new HNode(ins->starts, D); // 新建一个以起点为内容的高层节点H_init。
-  OPEN.push_front(H_init); // 将其插入OPEN表（待扩展节点队列）。
-  EXPLORED[H_init->Q] = H_init; // 标记为已探索，且加入垃圾回收管理队列。
-  GC_HNodes.push_back(H_init);
+  init();
 
   // search loop
   // 主搜索循环
   solver_info(2, "beam search iteration begins");
-  // 只要OPEN表不空，且没有超时，循环继续。
-  while (!OPEN.empty() && !is_expired(deadline))
+  while (step(INT_MAX)) {
+  }
+
+  return result();
+}
+
+// 初始化搜索状态，之后由 step() 推进
+void LaCAM::init()
+{
+  // insert initial node, or restore the search from a checkpoint
+  // 3: Open.push(Ninit); Explored[S] = Ninit
+  if (resume_file.empty() || !load_checkpoint(resume_file))
   {
-    ++loop_cnt; // 循环次数
+    H_init = new HNode(ins->starts, D); // 新建一个以起点为内容的高层节点H_init。
+    OPEN.push_front(H_init); // 将其插入OPEN表（待扩展节点队列）。
+    add_explored(H_init); // 标记为已探索，且加入垃圾回收管理队列。
+  }
+  finished = false;
+}
 
-    // random insert
-    // 增加搜索多样性（random restart/插入），利用概率在 OPEN 表头插入初始节点或其他随机节点。
-    if (H_goal != nullptr)
-    {
-      auto r = rrd(MT); // random, real distribution
-      if (r < RANDOM_INSERT_PROB2 / 2)
-      {
-        OPEN.push_front(H_init);
-      }
-      else if (r < RANDOM_INSERT_PROB2)
-      {
-        auto H = OPEN[get_random_int(MT, 0, OPEN.size() - 1)];
-        OPEN.push_front(H);
-      }
+// 在给定的迭代次数或时间内推进搜索，搜索结束时返回 false
+bool LaCAM::step(const int max_iterations, const double max_us)
+{
+  if (finished) return false;
+  const auto slice = Deadline(max_us / 1000);
+  auto slice_checker = DeadlineChecker(max_us > 0 ? &slice : nullptr);
+  for (auto k = 0; k < max_iterations; ++k) {
+    if (OPEN.empty() || deadline_checker.is_expired() || !iterate()) {
+      finish();
+      return false;
     }
+    if (slice_checker.is_expired()) break;
+  }
+  return true;
+}
+
+// 搜索循环的一次迭代
+bool LaCAM::iterate()
+{
+  ++loop_cnt;
 
-    // do not pop here!
-    // 取 OPEN 表头节点（注意：这里只取不弹，后面有条件才弹）。
-    auto H = OPEN.front();  // high-level node
+  // memory budget, cheaper strategies near the limit
+  if (check_memory()) return false;
 
-    // check uppwer bounds
-    // 如果当前已找到目标（H_goal非空），且当前节点 g 值不优于已知目标，则剪枝并把初始节点重新加入 OPEN，跳过当前分支。
-    if (H_goal != nullptr && H->g >= H_goal->g)
+  // periodic checkpoint, e.g., for preemptible jobs
+  if (!checkpoint_file.empty() &&
+      elapsed_ms(deadline) >= last_checkpoint_ms + CHECKPOINT_INTERVAL_MS)
+  {
+    save_checkpoint(checkpoint_file);
+    last_checkpoint_ms = elapsed_ms(deadline);
+  }
+
+  // random insert
+  // Anytime mode: 在找到一个可行解后，增加多样性（random restart/插入），利用概率在 OPEN 表头插入初始节点或其他随机节点。
+  if (H_goal != nullptr)
+  {
+    auto r = rrd(MT);
+    if (r < RANDOM_INSERT_PROB2 / 2)
     {
-      OPEN.pop_front();
-      solver_info(5, "prune, g=", H->g, " >= ", H_goal->g);
       OPEN.push_front(H_init);
-      continue;
     }
-
-    // check goal condition
-    // 如果是第一次到达所有agent目标，则设置H_goal。在非anytime模式下，找到后直接退出。
-    if (H_goal == nullptr && is_same_config(H->Q, ins->goals))
+    else if (r < RANDOM_INSERT_PROB2)
     {
-      H_goal = H;
-      solver_info(2, "found solution, g=", H->g, ", depth=", H->depth);
-      if (!ANYTIME) break;
-      continue;
+      OPEN.push_front(OPEN.get_random(MT));
     }
+  }
 
-    // extract constraints
-    // 若当前高层节点 search tree 为空，无子节点可扩展，则弹出 OPEN 并跳过。
-    if (H->search_tree.empty())
-    {
-      OPEN.pop_front();
-      continue;
-    }
-    auto L = H->search_tree.front();
-    H->search_tree.pop();
-
-    // low level search
-    // 扩展当前节点的低层树，随机化动作，逐步推进各智能体的动作组合（类似多队列 BFS 或多智能体交替扩展）。
-    if (L->depth < H->Q.size()) {
-      const auto i = H->order[L->depth];
-      auto &&C = H->Q[i]->actions;
-      std::shuffle(C.begin(), C.end(), MT);  // randomize
-      for (auto u : C) H->search_tree.push(new LNode(L, i, u));
-    }
+  // do not pop here!
+  // 5: N ←Open.top()
+  // 取 OPEN 表头节点（注意：这里只取不弹，后面有条件才弹）。
+  auto H = OPEN.front();  // high-level node
+
+  // check uppwer bounds
+  // 如果当前已找到目标（H_goal非空），且当前节点 g 值不优于已知目标，则剪枝并把初始节点重新加入 OPEN，跳过当前分支。
+  if (H_goal != nullptr && H->g >= H_goal->g)
+  {
+    OPEN.pop_front();
+    solver_info(5, "prune, g=", H->g, " >= ", H_goal->g);
+    OPEN.push_front(H_init);
+    return true;
+  }
+
+  // check goal condition
+  // 6: if N.config = G then return backtrack(N)
+  // 如果是第一次到达所有agent目标，则设置H_goal。在非anytime模式下，找到后直接退出。
+  if (H_goal == nullptr && is_goal(H))
+  {
+    H_goal = H;
+    solver_info(2, "found solution, g=", H->g, ", depth=", H->depth);
+    notify_improvement();
+    return anytime;
+  }
+
+  // extract constraints
+  // 7: if N.tree = ∅ then Open.pop(); continue
+  // 8: C ←N.tree.pop()
+  // low level search
+  // 9: if depth(C) ≤ |A| then
+  // 扩展当前节点的低层树，随机化动作，逐步推进各智能体的动作组合（类似多队列 BFS 或多智能体交替扩展）。
+  // 10: i←N.order[depth(C)]; v ← N.config[i]
+  // 11: foru∈neigh(v)∪{v}do
+  // 12:  Cnew←⟨parent :C,who :i,where : u⟩
+  // 13: N.tree.push(Cnew)
+  // 子约束不再一次性入队，而是由 pop_constraint 按需生成
+  if (batch_pool != nullptr) return expand_batch(H);
+  // 若当前高层节点 search tree 为空，无子节点可扩展，则弹出 OPEN 并跳过。
+  auto L = pop_constraint(H);
+  if (L == nullptr)
+  {
+    OPEN.pop_front();
+    release(H);
+    return true;
+  }
+
+  // create successors at the high-level search
+  // 14:  Qnew ←get new config(N,C)
+  // 生成新配置Q_to。
+  auto Q_to = Config(ins->N, nullptr);
+  // 验证有效后（set_new_config），生成新的高层节点。
+  auto res = set_new_config(H, L, Q_to);
+  if (!res) return true;
+  insert_successor(H, Q_to, pibt.activated);
+  return true;
+}
+
+// 从同一高层节点取出至多 BATCH_SIZE 个约束，并行生成配置后按固定顺序插入
+bool LaCAM::expand_batch(HNode *H)
+{
+  // constraints are copied out, an LNode is valid only until the next pop
+  auto num = 0;
+  while (num < BATCH_SIZE) {
+    auto L = pop_constraint(H);
+    if (L == nullptr) break;
+    std::fill(batch_Q[num].begin(), batch_Q[num].end(), nullptr);
+    H->get_constraints(L, batch_Q[num], batch_C[num]);
+    ++num;
+  }
+  if (num == 0) {
+    OPEN.pop_front();
+    release(H);
+    return true;
+  }
+
+  // generate configurations in parallel, slot-k always uses get_slot(k)
+  auto &&Q_from = config_cache.get(H);
+  auto &&E = *H->expansion;
+  batch_pool->run(num, [&](int k, int) {
+    batch_res[k] = get_slot(k).set_new_config(Q_from, batch_Q[k], E.order,
+                                              batch_C[k], E.num_active);
+  });
+
+  // insert in a fixed order, the first one ends up at the front of OPEN
+  for (auto k = num - 1; k >= 0; --k) {
+    if (batch_res[k]) insert_successor(H, batch_Q[k], get_slot(k).activated);
+  }
+  return true;
+}
+
+PIBT &LaCAM::get_slot(const int k)
+{
+  return k == 0 ? pibt : batch_pibts[k - 1];
+}
+
+// 将新配置插入高层搜索：新配置入 OPEN 与 EXPLORED，已知配置则更新代价
+void LaCAM::insert_successor(HNode *H, const Config &Q_to,
+                             const std::vector<int> &activated)
+{
+  // check explored list
+  auto &&Q_from = config_cache.get(H);
+  const auto hash = get_config_hash(H->hash, Q_from, Q_to);
+  auto H_known = find_explored(Q_to, hash);
+  // 如果新配置没被探索过，则新建高层节点，推进到OPEN和EXPLORED。
+  if (H_known == nullptr)
+  {
+    // new one -> insert
+    // 18: Open.push(Nnew); Explored[Qnew] = Nnew
+    auto H_new = new HNode(Q_to, D, H, get_g_val(H, activated),
+                           get_h_val(H, Q_to, activated), &activated, &Q_from);
+    if (anytime) H->neighbors.insert(H_new);
+    OPEN.push_front(H_new);
+    add_explored(H_new);
+  }
+  // 如果已经探索过，同步旧信息并根据概率插入不同类型的节点（增强搜索覆盖）。
+  else
+  {
+    // known configuration
+    rewrite(H, H_known);
 
-    // create successors at the high-level search
-    // 生成新配置Q_to。
-    auto Q_to = Config(ins->N, nullptr);
-    // 验证有效后（set_new_config），生成新的高层节点。
-    auto res = set_new_config(H, L, Q_to);
-    delete L;
-    if (!res) continue;
-
-    // check explored list
-    auto iter = EXPLORED.find(Q_to);
-    // 如果新配置没被探索过，则新建高层节点，推进到OPEN和EXPLORED。
-    if (iter == EXPLORED.end())
+    if (rrd(MT) >= RANDOM_INSERT_PROB1)
     {
-      // new one -> insert
-      auto H_new = new HNode(Q_to, D, H, get_g_val(H, Q_to), get_h_val(Q_to));
-      OPEN.push_front(H_new);
-      EXPLORED[H_new->Q] = H_new;
-      GC_HNodes.push_back(H_new);
+      OPEN.push_front(H_known);  // usual
     }
-    // 如果已经探索过，同步旧信息并根据概率插入不同类型的节点（增强搜索覆盖）。
     else
     {
-      // known configuration
-      auto H_known = iter->second;
-      rewrite(H, H_known);
-
-      if (rrd(MT) >= RANDOM_INSERT_PROB1)
-      {
-        OPEN.push_front(iter->second);  // usual
-      }
-      else
-      {
-        solver_info(3, "random restart");
-        OPEN.push_front(H_init);  // sometimes
-      }
+      solver_info(3, "random restart");
+      OPEN.push_front(H_init);  // sometimes
     }
   }
+}
 
+// 当前最优解，搜索未结束时也可调用
+Solution LaCAM::result() const
+{
+  // 内存不足时由 PIBT rollout 补全的解
+  if (!rollout_solution.empty()) return rollout_solution;
   // backtrack
   // 从终点H_goal开始，逐步追溯回父节点，重建整个路径，最终逆序得到从起点到终点的完整解。
-  Solution solution;
-  {
-    auto H = H_goal;
-    while (H != nullptr) {
-      solution.push_back(H->Q);
-      H = H->parent;
-    }
-    std::reverse(solution.begin(), solution.end());
-  }
+  return backtrack(H_goal);
+}
+
+// 搜索结束时的输出
+void LaCAM::finish()
+{
+  finished = true;
 
   // solution
-  if (solution.empty())
+  if (!rollout_solution.empty())
+  {
+    // 内存不足时由 PIBT rollout 补全的解
+    solver_info(2, "fin. memory limit, completed by PIBT, makespan=",
+                rollout_solution.size() - 1);
+  }
+  else if (H_goal == nullptr)
   {
     // 若无解且OPEN空，说明无解。
     if (OPEN.empty())
@@ -431,7 +794,10 @@ Solution LaCAM::solve_beam()
     // 若走到时间限制，则表示未找到解。
     else
     {
-      solver_info(2, "fin. reach time limit");
+      solver_info(2, memory_status == MemoryBudget::STOPPED
+                         ? "fin. reach memory limit"
+                     : is_cancelled(deadline) ? "fin. cancelled"
+                                              : "fin. reach time limit");
     }
   }
   else
@@ -450,25 +816,183 @@ Solution LaCAM::solve_beam()
     }
   }
 
-  // end processing
-  // 清理所有动态分配的高层节点，防止内存泄漏。
-  for (auto &&H : GC_HNodes) delete H;  // memory management
+  solver_info(2, "open: ", OPEN.size(), " nodes, ",
+              OPEN.nodes.size() - OPEN.size(), " tombstones");
+
+  // the search state at the end, resumable with a longer time limit
+  if (!checkpoint_file.empty()) save_checkpoint(checkpoint_file);
 
-  // 返回搜索到的solution路径（一个多步配置的数组，每个元素代表某一步所有智能体的联合状态）。
-  return solution;
 }
 
 // 据当前高层节点和低层节点，生成一个新的多智能体联合状态配置 Q_to，并通过底层的策略（如 PIBT 算法）进一步调整配置的可行性和细节。
 bool LaCAM::set_new_config(HNode *H, LNode *L, Config &Q_to)
 {
-  for (uint d = 0; d < L->depth; ++d) Q_to[L->who[d]] = L->where[d];
-  return pibt.set_new_config(H->Q, Q_to, H->order);
+  H->get_constraints(L, Q_to, constrained_agents);
+  return pibt.set_new_config(config_cache.get(H), Q_to, H->expansion->order,
+                             constrained_agents, H->expansion->num_active);
+}
+
+LNode *LaCAM::pop_constraint(HNode *H)
+{
+  // a new LNode, and the order grown by complete_order
+  const auto bytes = H->memory_usage();
+  auto L = H->pop_constraint(config_cache.get(H), MT);
+  allocate(H->memory_usage() - bytes);
+  return L;
+}
+
+void LaCAM::add_explored(HNode *H)
+{
+  EXPLORED.emplace(H->hash, H);
+  GC_HNodes.push_back(H);
+  allocate(H->memory_usage() + EXPLORED_ENTRY_BYTES);
+}
+
+// 释放展开状态；内存紧张时也从 EXPLORED 中移除，之后同一配置可能被重新生成
+void LaCAM::release(HNode *H)
+{
+  if (H->expansion == nullptr) return;
+  const auto bytes = H->memory_usage();
+  H->release();
+  spill(H);
+  deallocate(bytes - H->memory_usage());
+  if (memory_status < MemoryBudget::DROP_EXPLORED) return;
+  auto range = EXPLORED.equal_range(H->hash);
+  for (auto itr = range.first; itr != range.second; ++itr) {
+    if (itr->second == H) {
+      EXPLORED.erase(itr);
+      deallocate(EXPLORED_ENTRY_BYTES);
+      break;
+    }
+  }
+}
+
+// 磁盘空间不足时节点留在内存中，之后不再写入
+void LaCAM::spill(HNode *H)
+{
+  if (spill_file == nullptr || spill_file->failed) return;
+  if (!H->spill(*spill_file)) {
+    warn("spill file is full, nodes are kept in memory from now on");
+  }
+}
+
+// 内存接近上限时逐级降级：先丢弃已耗尽节点的 EXPLORED 项，
+// 再从 OPEN 的表头做 PIBT rollout，否则停止并返回 H_goal
+bool LaCAM::check_memory()
+{
+  if (budget == nullptr) return false;
+
+  // OPEN grows by reallocation, account its capacity
+  const auto bytes = OPEN.nodes.capacity() * sizeof(HNode *);
+  if (bytes > open_bytes) {
+    allocate(bytes - open_bytes);
+  } else {
+    deallocate(open_bytes - bytes);
+  }
+  open_bytes = bytes;
+  if (budget->limit == 0) return false;
+
+  if (budget->get_usage() >= MemoryBudget::DROP_EXPLORED_RATIO &&
+      memory_status < MemoryBudget::DROP_EXPLORED) {
+    memory_status = MemoryBudget::DROP_EXPLORED;
+    budget->degrade(MemoryBudget::DROP_EXPLORED);
+    auto cnt = 0;
+    for (auto itr = EXPLORED.begin(); itr != EXPLORED.end();) {
+      if (itr->second->expansion == nullptr) {
+        itr = EXPLORED.erase(itr);
+        ++cnt;
+      } else {
+        ++itr;
+      }
+    }
+    deallocate(cnt * EXPLORED_ENTRY_BYTES);
+    solver_info(1, "memory: ", budget->used_mb(), "MB, drop ", cnt,
+                " explored entries of exhausted nodes");
+  }
+  if (budget->get_usage() < MemoryBudget::ROLLOUT_RATIO) return false;
+
+  if (H_goal == nullptr) {
+    memory_status = MemoryBudget::ROLLOUT;
+    budget->degrade(MemoryBudget::ROLLOUT);
+    solver_info(1, "memory: ", budget->used_mb(), "MB, switch to PIBT");
+    // the search ends here, only configurations and parents are needed
+    for (auto H : GC_HNodes) {
+      const auto bytes = H->memory_usage();
+      H->release();
+      spill(H);
+      deallocate(bytes - H->memory_usage());
+    }
+    deallocate(EXPLORED.size() * EXPLORED_ENTRY_BYTES);
+    EXPLORED.clear();
+    rollout(OPEN.front());
+    if (!rollout_solution.empty()) return true;
+  }
+  memory_status = MemoryBudget::STOPPED;
+  budget->degrade(MemoryBudget::STOPPED);
+  solver_info(1, "memory: ", budget->used_mb(), "MB, stop search");
+  return true;
+}
+
+// 从 H 出发只用 PIBT 推进到目标，解 = 回溯到 H 的路径 + rollout 的配置
+void LaCAM::rollout(HNode *H)
+{
+  const auto config_bytes = ins->N * sizeof(Vertex *) + sizeof(Config);
+  const auto max_configs = budget->get_remaining() / config_bytes;
+  if (max_configs <= (size_t)H->depth + 1) return;
+  auto pibt_rollout = PIBTRollout(ins, D, verbose, deadline, seed);
+  pibt_rollout.max_timestep = std::min<size_t>(
+      PIBTRollout::MAX_TIMESTEP, max_configs - H->depth - 1);
+  // configurations are accounted as they are generated
+  auto configs = Solution();
+  const auto stats =
+      pibt_rollout.run(config_cache.get(H), [&](int, const Config &Q) {
+        configs.push_back(Q);
+        allocate(config_bytes);
+      });
+  if (!stats.solved) {
+    deallocate(configs.size() * config_bytes);
+    return;
+  }
+  rollout_solution = backtrack(H->parent);
+  allocate(rollout_solution.size() * config_bytes);
+  rollout_solution.insert(rollout_solution.end(),
+                          std::make_move_iterator(configs.begin()),
+                          std::make_move_iterator(configs.end()));
+}
+
+void LaCAM::allocate(size_t bytes)
+{
+  if (budget == nullptr) return;
+  budget->allocate(bytes);
+  accounted += bytes;
+}
+
+void LaCAM::deallocate(size_t bytes)
+{
+  if (budget == nullptr) return;
+  budget->deallocate(bytes);
+  accounted -= bytes;
+}
+
+// 按哈希查找已探索的配置，哈希相同时比较完整配置
+HNode *LaCAM::find_explored(const Config &Q, const uint64_t hash)
+{
+  auto range = EXPLORED.equal_range(hash);
+  for (auto itr = range.first; itr != range.second; ++itr) {
+    if (config_cache.is_same(itr->second, Q)) return itr->second;
+  }
+  return nullptr;
+}
+
+bool LaCAM::is_goal(const HNode *H)
+{
+  return H->hash == goal_hash && config_cache.is_same(H, ins->goals);
 }
 
 // 在“任意时刻（ANYTIME）”搜索模式下，动态修正高层节点间的可达关系，并重新优化相关路径开销。
 void LaCAM::rewrite(HNode *H_from, HNode *H_to)
 {
-  if (!ANYTIME) return;
+  if (!anytime) return;
 
   // update neighbors
   H_from->neighbors.insert(H_to);
@@ -478,8 +1002,10 @@ void LaCAM::rewrite(HNode *H_from, HNode *H_to)
   while (!Q.empty()) {
     auto n_from = Q.front();
     Q.pop();
+    auto &&Q_from = config_cache.get(n_from);
     for (auto n_to : n_from->neighbors) {
-      auto g_val = n_from->g + get_edge_cost(n_from->Q, n_to->Q);
+      auto g_val = n_from->g +
+                   get_edge_cost(Q_from, config_cache.get(n_to, false));
       if (g_val < n_to->g) {
         if (n_to == H_goal) {
           solver_info(2, "cost update: g=", H_goal->g, " -> ", g_val,
@@ -489,6 +1015,7 @@ void LaCAM::rewrite(HNode *H_from, HNode *H_to)
         n_to->f = n_to->g + n_to->h;
         n_to->parent = n_from;
         n_to->depth = n_from->depth + 1;
+        if (n_to == H_goal) notify_improvement();
         Q.push(n_to);
         if (H_goal != nullptr && n_to->f < H_goal->f) {
           OPEN.push_front(n_to);
@@ -499,18 +1026,37 @@ void LaCAM::rewrite(HNode *H_from, HNode *H_to)
   }
 }
 
+void LaCAM::notify_improvement()
+{
+  if (on_improve) on_improve(backtrack(H_goal), H_goal->g);
+}
+
 // 当前路径总代价 = 父节点路径总代价 + 本次跳转花费
-// g = g_prev + 1
-int LaCAM::get_g_val(HNode *H_parent, const Config &Q_to)
+// 与 get_edge_cost 相同：父节点的活跃智能体与离开目标的智能体各计 1
+int LaCAM::get_g_val(const HNode *H_parent, const std::vector<int> &activated)
 {
-  return H_parent->g + get_edge_cost(H_parent->Q, Q_to);
+  return H_parent->g + H_parent->expansion->num_active + activated.size();
 }
 
 // 给定当前所有智能体的状态配置 Q，计算一个乐观的（但可能小于实际值的）从当前配置到目标配置的总代价估计，用作A*等启发式搜索算法的h值。
 int LaCAM::get_h_val(const Config &Q)
 {
   auto c = 0;
-  for (size_t i = 0; i < ins->N; ++i) c += D->get(i, Q[i]);
+  for (size_t i = 0; i < ins->N; ++i) {
+    if (Q[i] != ins->goals[i]) c += D->get(i, Q[i]);  // skip settled agents
+  }
+  return c;
+}
+
+// 与 get_h_val(Q_to) 相同，只遍历可能不在目标上的智能体
+int LaCAM::get_h_val(const HNode *H_parent, const Config &Q_to,
+                     const std::vector<int> &activated)
+{
+  auto c = 0;
+  auto &&order = H_parent->expansion->order;
+  const auto num_active = H_parent->expansion->num_active;
+  for (auto k = 0; k < num_active; ++k) c += D->get(order[k], Q_to[order[k]]);
+  for (auto i : activated) c += D->get(i, Q_to[i]);
   return c;
 }
 
@@ -174,8 +174,12 @@ Solution LaCAM::solve()
     if (L->depth < H->Q.size()) {
       const auto i = H->order[L->depth];
       auto &&C = H->Q[i]->actions;
-      std::shuffle(C.begin(), C.end(), MT);  // randomize
-      for (auto u : C) H->search_tree.push(new LNode(L, i, u));
+      auto perm = std::array<int, 5>();
+      std::iota(perm.begin(), perm.begin() + C.size(), 0);
+      std::shuffle(perm.begin(), perm.begin() + C.size(), MT);  // randomize
+      for (size_t k = 0; k < C.size(); ++k) {
+        H->search_tree.push(new LNode(L, i, C[perm[k]]));
+      }
     }
 
     // create successors at the high-level search
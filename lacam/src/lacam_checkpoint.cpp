@@ -0,0 +1,354 @@
+#include "../include/lacam.hpp"
+
+/*
+ * binary checkpoint of LaCAM, native byte order, fixed-size fields;
+ * a file from a host of the other byte order fails the magic check:
+ *
+ * header: magic, version, N, |V|, hashes of starts and goals
+ * search: loop_cnt, H_init, H_goal, RNG states of LaCAM and PIBT
+ * nodes:  configuration (vertex ids), g, h, depth, parent, in EXPLORED,
+ *         neighbors, expansion state (priorities, order, low-level tree)
+ * OPEN:   node indices from the back, -1 for tombstones
+ *
+ * Nodes are referred to by their index in GC_HNodes, -1 -> nullptr.
+ * Configurations are stored fully, so resumed nodes are not delta-encoded.
+ */
+
+static constexpr uint64_t CHECKPOINT_MAGIC = 0x31504b434d41434cULL;  // LCAMCKP1
+static constexpr uint32_t CHECKPOINT_VERSION = 1;
+
+template <typename T>
+static void write_value(std::ofstream &out, const T &v)
+{
+  out.write(reinterpret_cast<const char *>(&v), sizeof(T));
+}
+
+template <typename T>
+static void write_vector(std::ofstream &out, const std::vector<T> &v)
+{
+  write_value(out, (uint64_t)v.size());
+  out.write(reinterpret_cast<const char *>(v.data()), sizeof(T) * v.size());
+}
+
+template <typename T>
+static bool read_value(std::ifstream &in, T &v)
+{
+  in.read(reinterpret_cast<char *>(&v), sizeof(T));
+  return (bool)in;
+}
+
+// sizes are also bounded by the rest of the file, so that a broken size
+// fails instead of allocating
+template <typename T>
+static bool read_vector(std::ifstream &in, std::vector<T> &v,
+                        const uint64_t max_size, const uint64_t file_size)
+{
+  auto size = uint64_t(0);
+  if (!read_value(in, size) || size > max_size ||
+      size > (file_size - (uint64_t)in.tellg()) / sizeof(T)) {
+    return false;
+  }
+  v.resize(size);
+  in.read(reinterpret_cast<char *>(v.data()), sizeof(T) * size);
+  return (bool)in;
+}
+
+// 写入临时文件后重命名，进程在写入途中被终止也不会破坏上一个检查点
+bool LaCAM::save_checkpoint(const std::string &filename)
+{
+  const auto tmp_filename = filename + ".tmp";
+  std::ofstream out(tmp_filename, std::ios::binary);
+  if (!out) {
+    warn("failed to write checkpoint ", filename);
+    return false;
+  }
+
+  const int num_nodes = GC_HNodes.size();
+  auto index = std::unordered_map<const HNode *, int32_t>();
+  index.reserve(num_nodes);
+  for (auto k = 0; k < num_nodes; ++k) index[GC_HNodes[k]] = k;
+  auto get_index = [&](const HNode *H) -> int32_t {
+    return H == nullptr ? -1 : index[H];
+  };
+  auto in_explored = std::vector<uint8_t>(num_nodes, 0);
+  for (auto &&e : EXPLORED) in_explored[index[e.second]] = 1;
+
+  // header
+  write_value(out, CHECKPOINT_MAGIC);
+  write_value(out, CHECKPOINT_VERSION);
+  write_value(out, (uint32_t)ins->N);
+  write_value(out, (uint32_t)ins->G.size());
+  write_value(out, get_config_hash(ins->starts));
+  write_value(out, goal_hash);
+
+  // search
+  write_value(out, (int32_t)loop_cnt);
+  write_value(out, get_index(H_init));
+  write_value(out, get_index(H_goal));
+  std::ostringstream rng;
+  rng << MT;
+  const auto rng_str = rng.str();
+  write_vector(out, std::vector<char>(rng_str.begin(), rng_str.end()));
+  write_value(out, pibt.MT);  // tie-breaking
+  write_value(out, (uint32_t)pibt.epoch);  // tie-breaking in the cluster mode
+
+  // nodes
+  write_value(out, (int32_t)num_nodes);
+  auto ids = std::vector<uint32_t>(ins->N);
+  auto neighbors = std::vector<int32_t>();
+  for (auto k = 0; k < num_nodes; ++k) {
+    const auto H = GC_HNodes[k];
+    auto &&Q = config_cache.get(H, false);
+    for (size_t i = 0; i < ins->N; ++i) ids[i] = Q[i]->id;
+    out.write(reinterpret_cast<const char *>(ids.data()),
+              sizeof(uint32_t) * ids.size());
+    write_value(out, (int32_t)H->g);
+    write_value(out, (int32_t)H->h);
+    write_value(out, (int32_t)H->depth);
+    write_value(out, get_index(H->parent));
+    write_value(out, in_explored[k]);
+    neighbors.clear();
+    for (auto n : H->neighbors) neighbors.push_back(get_index(n));
+    write_vector(out, neighbors);
+
+    // expansion state
+    write_value(out, (uint8_t)(H->expansion != nullptr));
+    if (H->expansion == nullptr) continue;
+    auto &&E = *H->expansion;
+    write_vector(out, E.priorities);
+    write_vector(out, E.order);
+    write_value(out, (int32_t)E.num_active);
+    write_value(out, (uint64_t)E.search_tree.size());
+    for (auto &&L : E.search_tree) {
+      write_value(out, (int32_t)L.parent);
+      write_value(out, (int32_t)L.who);
+      write_value(out, (int32_t)(L.where == nullptr ? -1 : L.where->id));
+      write_value(out, (uint32_t)L.depth);
+      write_value(out, L.num_children);
+      write_value(out, L.perm);
+    }
+    write_value(out, (uint64_t)E.cursor_node);
+    write_value(out, (int32_t)E.cursor_action);
+    write_value(out, (uint8_t)E.exhausted);
+  }
+
+  // OPEN
+  auto open_nodes = std::vector<int32_t>();
+  for (auto H : OPEN.nodes) open_nodes.push_back(get_index(H));
+  write_vector(out, open_nodes);
+
+  out.close();
+  if (!out || std::rename(tmp_filename.c_str(), filename.c_str()) != 0) {
+    warn("failed to write checkpoint ", filename);
+    return false;
+  }
+  solver_info(2, "checkpoint: ", filename, ", nodes: ", num_nodes);
+  return true;
+}
+
+// 读取检查点；文件不完整或与实例不符时不修改当前状态
+bool LaCAM::load_checkpoint(const std::string &filename)
+{
+  std::ifstream in(filename, std::ios::binary | std::ios::ate);
+  if (!in) {
+    warn("failed to open checkpoint ", filename);
+    return false;
+  }
+  const uint64_t file_size = in.tellg();
+  in.seekg(0);
+  auto nodes = HNodes();
+  auto fail = [&](const char *reason) {
+    for (auto H : nodes) delete H;
+    warn("ignore checkpoint ", filename, ", ", reason);
+    return false;
+  };
+
+  // header
+  uint64_t magic, starts_hash, goals_hash;
+  uint32_t version, N, K;
+  if (!read_value(in, magic) || magic != CHECKPOINT_MAGIC ||
+      !read_value(in, version) || version != CHECKPOINT_VERSION) {
+    return fail("unknown format");
+  }
+  if (!read_value(in, N) || !read_value(in, K) ||
+      !read_value(in, starts_hash) || !read_value(in, goals_hash) ||
+      N != ins->N || (int)K != ins->G.size() ||
+      starts_hash != get_config_hash(ins->starts) || goals_hash != goal_hash) {
+    return fail("different instance");
+  }
+
+  // search
+  int32_t cnt, k_init, k_goal, num_nodes;
+  auto is_node = [&](int32_t k) { return k >= -1 && k < num_nodes; };
+  auto rng_str = std::vector<char>();
+  auto pibt_MT = pibt.MT;
+  uint32_t pibt_epoch;
+  if (!read_value(in, cnt) || !read_value(in, k_init) ||
+      !read_value(in, k_goal) ||
+      !read_vector(in, rng_str, 1 << 20, file_size) ||
+      !read_value(in, pibt_MT) || !read_value(in, pibt_epoch) ||
+      !read_value(in, num_nodes) || num_nodes <= 0 ||
+      (uint64_t)num_nodes * N * sizeof(uint32_t) > file_size || k_init < 0 ||
+      k_init >= num_nodes || !is_node(k_goal)) {
+    return fail("broken header");
+  }
+
+  // nodes, links are resolved after all nodes are created
+  auto ids = std::vector<uint32_t>(N);
+  auto Q = Config(N, nullptr);
+  auto parents = std::vector<int32_t>(num_nodes);
+  auto in_explored = std::vector<uint8_t>(num_nodes);
+  auto neighbors = std::vector<std::vector<int32_t>>(num_nodes);
+  auto is_vertex = [&](int32_t id) { return id >= 0 && id < (int)K; };
+  for (auto k = 0; k < num_nodes; ++k) {
+    in.read(reinterpret_cast<char *>(ids.data()), sizeof(uint32_t) * N);
+    int32_t g, h, depth;
+    if (!read_value(in, g) || !read_value(in, h) || !read_value(in, depth) ||
+        !read_value(in, parents[k]) || !read_value(in, in_explored[k]) ||
+        !read_vector(in, neighbors[k], num_nodes, file_size) ||
+        !is_node(parents[k])) {
+      return fail("broken node");
+    }
+    for (size_t i = 0; i < N; ++i) {
+      if (!is_vertex(ids[i])) return fail("broken node");
+      Q[i] = ins->G.V[ids[i]];
+    }
+    for (auto n : neighbors[k]) {
+      if (n < 0 || !is_node(n)) return fail("broken node");
+    }
+    auto H = new HNode(Q, g, h, depth);
+    nodes.push_back(H);
+
+    // expansion state
+    uint8_t has_expansion;
+    if (!read_value(in, has_expansion)) return fail("broken node");
+    if (!has_expansion) continue;
+    auto priorities = std::vector<Priority>();
+    if (!read_vector(in, priorities, N, file_size) || priorities.size() != N) {
+      return fail("broken expansion");
+    }
+    H->expansion = std::make_unique<HNodeExpansion>(priorities);
+    auto &&E = *H->expansion;
+    auto order = std::vector<int>();
+    uint64_t tree_size;
+    if (!read_vector(in, order, N, file_size) ||
+        !read_value(in, E.num_active) ||
+        !read_value(in, tree_size) || tree_size == 0) {
+      return fail("broken expansion");
+    }
+    // distinct agents, the active ones first
+    auto in_order = std::vector<char>(N, false);
+    for (auto i : order) {
+      if (i < 0 || i >= (int)N || in_order[i]) return fail("broken expansion");
+      in_order[i] = true;
+    }
+    if (E.num_active < 0 || E.num_active > (int)order.size()) {
+      return fail("broken expansion");
+    }
+    // agent of each depth of the low-level tree, as completed on demand
+    E.order.assign(order.begin(), order.end());  // keep the capacity
+    H->complete_order();
+    const auto full_order = E.order;
+    E.order.resize(order.size());
+    E.search_tree.clear();
+    for (uint64_t j = 0; j < tree_size; ++j) {
+      int32_t parent, who, where;
+      uint32_t l_depth;
+      uint8_t num_children;
+      std::array<uint8_t, 5> perm;
+      if (!read_value(in, parent) || !read_value(in, who) ||
+          !read_value(in, where) || !read_value(in, l_depth) ||
+          !read_value(in, num_children) || !read_value(in, perm)) {
+        return fail("broken expansion");
+      }
+      // the root has no constraint, others constrain the agent of the depth
+      // of their parent to a vertex
+      if (j == 0) {
+        if (parent != -1 || who != -1 || where != -1 || l_depth != 0) {
+          return fail("broken expansion");
+        }
+      } else if (parent < 0 || parent >= (int64_t)j || l_depth > N ||
+                 l_depth != E.search_tree[parent].depth + 1 ||
+                 who != full_order[l_depth - 1] || !is_vertex(where)) {
+        return fail("broken expansion");
+      }
+      // children are actions of the agent of this depth
+      const auto K =
+          l_depth < N ? Q[full_order[l_depth]]->actions.size() : size_t(0);
+      if (num_children > K) return fail("broken expansion");
+      for (auto k = 0; k < num_children; ++k) {
+        if (perm[k] >= K) return fail("broken expansion");
+      }
+      E.search_tree.emplace_back(parent, l_depth, who,
+                                 where < 0 ? nullptr : ins->G.V[where]);
+      E.search_tree.back().num_children = num_children;
+      E.search_tree.back().perm = perm;
+    }
+    uint64_t cursor_node;
+    uint8_t exhausted;
+    if (!read_value(in, cursor_node) || !read_value(in, E.cursor_action) ||
+        !read_value(in, exhausted)) {
+      return fail("broken expansion");
+    }
+    E.cursor_node = cursor_node;
+    E.exhausted = exhausted;
+    // pop_constraint reads the cursor node unless the tree is exhausted
+    if (E.cursor_action < -1 ||
+        (E.cursor_action == -1 && (cursor_node != 0 || tree_size != 1)) ||
+        (!E.exhausted && cursor_node >= tree_size) ||
+        (E.exhausted && cursor_node > tree_size) ||
+        (cursor_node < tree_size &&
+         E.cursor_action > E.search_tree[cursor_node].num_children)) {
+      return fail("broken expansion");
+    }
+  }
+  auto open_nodes = std::vector<int32_t>();
+  if (!read_vector(in, open_nodes, UINT32_MAX, file_size)) {
+    return fail("broken OPEN");
+  }
+  auto in_open = std::vector<bool>(num_nodes, false);
+  for (auto k : open_nodes) {
+    if (!is_node(k)) return fail("broken OPEN");
+    if (k < 0) continue;  // tombstones may repeat
+    if (in_open[k]) return fail("broken OPEN");
+    in_open[k] = true;
+  }
+  // parents form a tree, backtracking ends at the initial node
+  auto state = std::vector<uint8_t>(num_nodes, 0);  // 1: visiting, 2: done
+  for (auto k = 0; k < num_nodes; ++k) {
+    auto j = k;
+    for (; j >= 0 && state[j] == 0; j = parents[j]) state[j] = 1;
+    if (j >= 0 && state[j] == 1) return fail("broken node");
+    for (j = k; j >= 0 && state[j] == 1; j = parents[j]) state[j] = 2;
+  }
+
+  // commit
+  for (auto k = 0; k < num_nodes; ++k) {
+    auto H = nodes[k];
+    if (parents[k] >= 0) H->parent = nodes[parents[k]];
+    for (auto n : neighbors[k]) H->neighbors.insert(nodes[n]);
+    if (H->expansion == nullptr) spill(H);
+    if (in_explored[k]) {
+      add_explored(H);
+    } else {
+      GC_HNodes.push_back(H);
+      allocate(H->memory_usage());
+    }
+  }
+  for (auto k : open_nodes) {
+    auto H = k < 0 ? nullptr : nodes[k];
+    if (H != nullptr) H->open_index = OPEN.nodes.size();
+    OPEN.nodes.push_back(H);
+    ++(H == nullptr ? OPEN.num_tombstones : OPEN.num_nodes);
+  }
+  H_init = nodes[k_init];
+  H_goal = k_goal < 0 ? nullptr : nodes[k_goal];
+  loop_cnt = cnt;
+  std::istringstream(std::string(rng_str.begin(), rng_str.end())) >> MT;
+  pibt.MT = pibt_MT;
+  pibt.epoch = pibt_epoch;
+  solver_info(1, "resume from ", filename, ", nodes: ", num_nodes,
+              ", open: ", OPEN.size());
+  if (H_goal != nullptr) notify_improvement();
+  return true;
+}
@@ -0,0 +1,430 @@
+#include "../include/lacam_parallel.hpp"
+
+int ParallelLaCAM::NUM_THREADS = 1;
+bool ParallelLaCAM::DETERMINISTIC = false;
+int ParallelLaCAM::EXPLORED_BUCKETS_LOG2 = 20;
+
+static constexpr int NUM_NODE_LOCKS = 1024;
+
+ConcurrentExplored::ConcurrentExplored(const int num_buckets_log2)
+    : mask((size_t(1) << num_buckets_log2) - 1), buckets(mask + 1)
+{
+  for (auto &&b : buckets) b.store(nullptr);
+}
+
+ConcurrentExplored::~ConcurrentExplored()
+{
+  for (auto &&b : buckets) {
+    auto e = b.load();
+    while (e != nullptr) {
+      auto e_next = e->next;
+      delete e;
+      e = e_next;
+    }
+  }
+}
+
+HNode *ConcurrentExplored::find(const Config &Q, const uint64_t hash,
+                                ConfigCache &cache) const
+{
+  for (auto e = buckets[hash & mask].load(); e != nullptr; e = e->next) {
+    if (e->hash == hash && cache.is_same(e->H, Q)) return e->H;
+  }
+  return nullptr;
+}
+
+// 无锁插入：在桶头 CAS，失败时只需检查新加入的表项
+HNode *ConcurrentExplored::insert(HNode *H, const Config &Q,
+                                  ConfigCache &cache)
+{
+  const auto hash = H->hash;
+  auto &&bucket = buckets[hash & mask];
+  auto new_entry = new Entry{H, hash, nullptr};
+  Entry *checked = nullptr;  // entries after this are already checked
+  auto head = bucket.load();
+  while (true) {
+    for (auto e = head; e != checked; e = e->next) {
+      if (e->hash == hash && cache.is_same(e->H, Q)) {
+        delete new_entry;
+        return e->H;
+      }
+    }
+    checked = head;
+    new_entry->next = head;
+    if (bucket.compare_exchange_weak(head, new_entry)) return H;
+  }
+}
+
+ParallelLaCAM::ParallelLaCAM(const Instance *_ins, DistTable *_D,
+                             int _verbose, const Deadline *_deadline,
+                             int _seed, int _num_threads,
+                             MemoryBudget *_budget,
+                             const ImproveCallback &_on_improve)
+    : ins(_ins),
+      D(_D),
+      deadline(_deadline),
+      seed(_seed),
+      verbose(_verbose),
+      num_threads(std::max(1, _num_threads)),
+      budget(_budget),
+      on_improve(_on_improve),
+      pool(num_threads),
+      pibts(),
+      MTs(),
+      caches(num_threads),
+      goal_hash(get_config_hash(ins->goals)),
+      EXPLORED(EXPLORED_BUCKETS_LOG2),
+      node_locks(NUM_NODE_LOCKS),
+      OPENs(num_threads),
+      H_init(nullptr),
+      H_goal(nullptr),
+      num_pending(0),
+      stop(false),
+      loop_cnt(0),
+      num_explored(0)
+{
+  pibts.reserve(num_threads);
+  for (auto w = 0; w < num_threads; ++w) {
+    pibts.emplace_back(ins, D, seed + w, 1);  // no nested thread pools
+    MTs.emplace_back(seed + w);
+  }
+}
+
+ParallelLaCAM::~ParallelLaCAM() {}
+
+Solution ParallelLaCAM::solve()
+{
+  solver_info(1, "parallel LaCAM begins, threads: ", num_threads,
+              ", deterministic: ", DETERMINISTIC);
+  if (LaCAM::ANYTIME) warn("parallel LaCAM ignores the anytime option");
+
+  H_init = new HNode(ins->starts, D);
+  EXPLORED.insert(H_init, ins->starts, caches[0]);
+  num_explored = 1;
+  if (budget != nullptr) {
+    budget->allocate(H_init->memory_usage() + EXPLORED_ENTRY_BYTES);
+  }
+
+  if (DETERMINISTIC) {
+    search_deterministic();
+  } else {
+    search_work_stealing();
+  }
+
+  // backtrack
+  auto solution = backtrack(H_goal.load());
+
+  const auto elapsed = std::max(elapsed_ms(deadline), 1.0);
+  if (solution.empty()) {
+    solver_info(2, is_out_of_memory(budget) ? "fin. reach memory limit"
+                   : is_cancelled(deadline) ? "fin. cancelled"
+                   : is_expired(deadline)   ? "fin. reach time limit"
+                                            : "fin. unsolvable instance");
+  } else {
+    solver_info(2, "fin. solution found, g=", H_goal.load()->g,
+                ", depth=", H_goal.load()->depth);
+  }
+  solver_info(2, "explored: ", num_explored.load(),
+              " nodes, throughput: ", (int)(num_explored / elapsed * 1000),
+              " nodes/sec");
+
+  // end processing
+  EXPLORED.for_each([&](HNode *H) {
+    if (budget != nullptr) {
+      budget->deallocate(H->memory_usage() + EXPLORED_ENTRY_BYTES);
+    }
+    delete H;  // memory management
+  });
+
+  return solution;
+}
+
+// 多线程版本：每个线程持有自己的 OPEN，空闲时从其它线程的尾部窃取节点
+void ParallelLaCAM::search_work_stealing()
+{
+  push_front(0, H_init);
+  pool.run(num_threads, [&](int k, int) { worker(k); });
+}
+
+void ParallelLaCAM::worker(const int w)
+{
+  auto &&MT = MTs[w];
+  auto &&pibt = pibts[w];
+  auto &&cache = caches[w];
+  auto rrd = std::uniform_real_distribution<float>(0, 1);
+  auto Q_to = Config(ins->N, nullptr);
+  auto constrained_agents = std::vector<int>();
+  auto order = std::vector<int>();
+  auto checker = DeadlineChecker(deadline);
+
+  while (!stop) {
+    if (is_stopped(checker)) {
+      stop = true;
+      break;
+    }
+
+    auto H = pop(w);
+    if (H == nullptr) {
+      if (num_pending == 0) break;  // all OPENs are empty
+      std::this_thread::yield();
+      continue;
+    }
+    ++loop_cnt;
+
+    // check goal condition
+    if (is_goal(H, cache)) {
+      HNode *expected = nullptr;
+      if (H_goal.compare_exchange_strong(expected, H)) {
+        solver_info(2, "found solution, g=", H->g, ", depth=", H->depth);
+        if (on_improve) on_improve(backtrack(H), H->g);
+      }
+      stop = true;
+      --num_pending;
+      break;
+    }
+
+    // extract constraints, H is kept in OPEN until its tree is exhausted
+    auto &&Q_from = cache.get(H);
+    if (!extract_constraint(H, Q_from, MT, Q_to, constrained_agents, order)) {
+      --num_pending;
+      continue;
+    }
+    push_front(w, H);
+
+    // create successors at the high-level search
+    const auto res =
+        set_new_config(Q_from, Q_to, constrained_agents, order, pibt);
+    if (res) {
+      bool is_new;
+      auto H_next =
+          insert_config(H, Q_from, Q_to, pibt.activated, cache, is_new);
+      if (!is_new && rrd(MT) < LaCAM::RANDOM_INSERT_PROB1) H_next = H_init;
+      push_front(w, H_next);
+    }
+    finish_constraint(H);
+    --num_pending;
+  }
+}
+
+// 确定性版本：按轮次批量取出约束，各槽位使用固定的 PIBT 实例并行生成配置，再按顺序插入
+void ParallelLaCAM::search_deterministic()
+{
+  auto &&MT = MTs[0];
+  auto rrd = std::uniform_real_distribution<float>(0, 1);
+  auto &&OPEN = OPENs[0].nodes;
+  auto batch_H = std::vector<HNode *>();
+  auto batch_Q = std::vector<Config>(num_threads, Config(ins->N, nullptr));
+  auto batch_res = std::vector<char>(num_threads, false);
+  auto batch_C = std::vector<std::vector<int>>(num_threads);
+  auto batch_order = std::vector<std::vector<int>>(num_threads);
+  auto checker = DeadlineChecker(deadline);
+
+  OPEN.push_front(H_init);
+  while (!OPEN.empty() && !is_stopped(checker)) {
+    ++loop_cnt;
+
+    // extract up to |threads| constraints, from the front of OPEN
+    batch_H.clear();
+    while ((int)batch_H.size() < num_threads && !OPEN.empty()) {
+      auto H = OPEN.front();
+      if (is_goal(H, caches[0])) {
+        H_goal = H;
+        break;
+      }
+      const int k = batch_H.size();
+      if (!extract_constraint(H, caches[0].get(H, false), MT, batch_Q[k],
+                              batch_C[k], batch_order[k])) {
+        OPEN.pop_front();
+        continue;
+      }
+      batch_H.push_back(H);
+    }
+    if (H_goal != nullptr) {
+      solver_info(2, "found solution, g=", H_goal.load()->g,
+                  ", depth=", H_goal.load()->depth);
+      if (on_improve) on_improve(backtrack(H_goal), H_goal.load()->g);
+      break;
+    }
+
+    // generate configurations in parallel, slot-k always uses pibts[k]
+    pool.run(batch_H.size(), [&](int k, int) {
+      batch_res[k] = set_new_config(caches[k].get(batch_H[k]), batch_Q[k],
+                                    batch_C[k], batch_order[k], pibts[k]);
+    });
+
+    // insert in a fixed order, the first one ends up at the front of OPEN
+    for (int k = batch_H.size() - 1; k >= 0; --k) {
+      if (batch_res[k]) {
+        bool is_new;
+        auto H_next =
+            insert_config(batch_H[k], caches[k].get(batch_H[k]), batch_Q[k],
+                          pibts[k].activated, caches[k], is_new);
+        if (!is_new && rrd(MT) < LaCAM::RANDOM_INSERT_PROB1) H_next = H_init;
+        OPEN.push_front(H_next);
+      }
+      finish_constraint(batch_H[k]);
+    }
+  }
+}
+
+std::mutex &ParallelLaCAM::get_lock(const HNode *H)
+{
+  return node_locks[(reinterpret_cast<uintptr_t>(H) >> 4) % NUM_NODE_LOCKS];
+}
+
+void ParallelLaCAM::push_front(const int w, HNode *H)
+{
+  ++num_pending;
+  auto &&q = OPENs[w];
+  std::lock_guard<std::mutex> lock(q.mtx);
+  q.nodes.push_front(H);
+}
+
+HNode *ParallelLaCAM::pop(const int w)
+{
+  // own OPEN
+  {
+    auto &&q = OPENs[w];
+    std::lock_guard<std::mutex> lock(q.mtx);
+    if (!q.nodes.empty()) {
+      auto H = q.nodes.front();
+      q.nodes.pop_front();
+      return H;
+    }
+  }
+  // steal from others
+  for (auto k = 1; k < num_threads; ++k) {
+    auto &&q = OPENs[(w + k) % num_threads];
+    std::lock_guard<std::mutex> lock(q.mtx);
+    if (!q.nodes.empty()) {
+      auto H = q.nodes.back();
+      q.nodes.pop_back();
+      return H;
+    }
+  }
+  return nullptr;
+}
+
+// 取出一个约束并在锁内写出，低层搜索树与智能体顺序可能被其它线程扩展
+bool ParallelLaCAM::extract_constraint(HNode *H, const Config &Q_from,
+                                       std::mt19937 &MT, Config &Q_to,
+                                       std::vector<int> &constrained_agents,
+                                       std::vector<int> &order)
+{
+  std::lock_guard<std::mutex> lock(get_lock(H));
+  const auto bytes = H->memory_usage();
+  auto L = H->pop_constraint(Q_from, MT);
+  if (budget != nullptr) {
+    budget->allocate(H->memory_usage() - bytes);
+  }
+  if (L == nullptr) {
+    if (H->expansion != nullptr && H->expansion->num_in_flight == 0) {
+      release(H);
+    }
+    return false;
+  }
+  ++H->expansion->num_in_flight;
+  std::fill(Q_to.begin(), Q_to.end(), nullptr);
+  H->get_constraints(L, Q_to, constrained_agents);
+  // snapshot, complete_order may append to the order of H meanwhile
+  auto &&E = *H->expansion;
+  order.assign(E.order.begin(), E.order.begin() + E.num_active);
+  return true;
+}
+
+// 约束使用完毕；低层搜索已结束且无其它线程使用时释放展开状态
+void ParallelLaCAM::finish_constraint(HNode *H)
+{
+  std::lock_guard<std::mutex> lock(get_lock(H));
+  auto &&E = H->expansion;
+  if (--E->num_in_flight == 0 && E->exhausted) release(H);
+}
+
+void ParallelLaCAM::release(HNode *H)
+{
+  if (budget != nullptr) budget->deallocate(H->expansion->memory_usage());
+  H->release();
+}
+
+bool ParallelLaCAM::is_stopped(DeadlineChecker &checker)
+{
+  if (is_exceeded(budget)) {
+    budget->degrade(MemoryBudget::STOPPED);
+    return true;
+  }
+  return checker.is_expired();
+}
+
+bool ParallelLaCAM::set_new_config(const Config &Q_from, Config &Q_to,
+                                   const std::vector<int> &constrained_agents,
+                                   const std::vector<int> &order, PIBT &pibt)
+{
+  return pibt.set_new_config(Q_from, Q_to, order, constrained_agents);
+}
+
+// 查重并插入新配置；若与其它线程竞争失败则丢弃本线程创建的节点
+HNode *ParallelLaCAM::insert_config(HNode *H, const Config &Q_from,
+                                    const Config &Q_to,
+                                    const std::vector<int> &activated,
+                                    ConfigCache &cache, bool &is_new)
+{
+  const auto hash = get_config_hash(H->hash, Q_from, Q_to);
+  auto H_known = EXPLORED.find(Q_to, hash, cache);
+  if (H_known != nullptr) {
+    is_new = false;
+    return H_known;
+  }
+
+  HNode *H_new;
+  {
+    // the order of H may be completed by other threads meanwhile
+    std::lock_guard<std::mutex> lock(get_lock(H));
+    H_new = new HNode(Q_to, D, H, get_g_val(H, activated),
+                      get_h_val(H, Q_to, activated), &activated, &Q_from);
+  }
+  // other threads may expand H_new once it is inserted
+  const auto bytes = H_new->memory_usage() + EXPLORED_ENTRY_BYTES;
+  H_known = EXPLORED.insert(H_new, Q_to, cache);
+  if (H_known == H_new) {
+    ++num_explored;
+    if (budget != nullptr) budget->allocate(bytes);
+    is_new = true;
+    return H_new;
+  }
+
+  // lost the race
+  delete H_new;
+  is_new = false;
+  return H_known;
+}
+
+int ParallelLaCAM::get_g_val(const HNode *H_parent,
+                             const std::vector<int> &activated)
+{
+  return H_parent->g + H_parent->expansion->num_active + activated.size();
+}
+
+bool ParallelLaCAM::is_goal(const HNode *H, ConfigCache &cache)
+{
+  return H->hash == goal_hash && cache.is_same(H, ins->goals);
+}
+
+int ParallelLaCAM::get_h_val(const Config &Q)
+{
+  auto c = 0;
+  for (size_t i = 0; i < ins->N; ++i) {
+    if (Q[i] != ins->goals[i]) c += D->get(i, Q[i]);  // skip settled agents
+  }
+  return c;
+}
+
+int ParallelLaCAM::get_h_val(const HNode *H_parent, const Config &Q_to,
+                             const std::vector<int> &activated)
+{
+  auto c = 0;
+  auto &&order = H_parent->expansion->order;
+  const auto num_active = H_parent->expansion->num_active;
+  for (auto k = 0; k < num_active; ++k) c += D->get(order[k], Q_to[order[k]]);
+  for (auto i : activated) c += D->get(i, Q_to[i]);
+  return c;
+}
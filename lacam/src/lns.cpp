@@ -0,0 +1,374 @@
+#include "../include/lns.hpp"
+
+#include <unordered_set>
+
+bool LNS::ENABLED = false;
+int LNS::NUM_THREADS = 4;
+int LNS::NEIGHBOR_SIZE = 8;
+double LNS::REACTION = 0.01;
+int LNS::MAX_ROUNDS = INT_MAX;
+
+LNS::LNS(const Instance *_ins, DistTable *_D, const Solution &solution,
+         int _verbose, const Deadline *_deadline, int seed)
+    : ins(_ins),
+      D(_D),
+      verbose(_verbose),
+      deadline(_deadline),
+      num_threads(std::max(1, NUM_THREADS)),
+      neighbor_size(std::max(1, NEIGHBOR_SIZE)),
+      paths(ins->N),
+      sum_of_loss(0),
+      lower_bound(get_sum_of_costs_lower_bound(*ins, *D)),
+      table(ins->G.size()),
+      goal_owner(ins->G.size(), -1),
+      weights(NUM_NEIGHBORHOODS, 1.0),
+      MTs(),
+      curve(),
+      pool(num_threads)
+{
+  for (auto k = 0; k < num_threads; ++k) MTs.emplace_back(seed + k);
+  for (size_t i = 0; i < ins->N; ++i) goal_owner[ins->goals[i]->id] = i;
+
+  // paths end at the arrival
+  for (size_t i = 0; i < ins->N; ++i) {
+    auto T = solution.size() - 1;
+    while (T > 0 && solution[T - 1][i] == ins->goals[i]) --T;
+    auto path = Path();
+    for (size_t t = 0; t <= T; ++t) path.push_back(solution[t][i]);
+    sum_of_loss += get_path_loss(path);
+    add_path(i, path);
+  }
+}
+
+Solution LNS::get_solution() const
+{
+  auto T = size_t(0);
+  for (auto &&path : paths) T = std::max(T, path.size());
+  auto solution = Solution(T, Config(ins->N, nullptr));
+  for (size_t t = 0; t < T; ++t) {
+    for (size_t i = 0; i < ins->N; ++i) {
+      solution[t][i] = paths[i][std::min(t, paths[i].size() - 1)];
+    }
+  }
+  return solution;
+}
+
+void LNS::add_path(const int i, const Path &path)
+{
+  paths[i] = path;
+  for (size_t t = 0; t + 1 < path.size(); ++t) {
+    auto &&entries = table[path[t]->id];
+    const auto e = std::make_pair((int)t, i);
+    entries.insert(std::lower_bound(entries.begin(), entries.end(), e), e);
+  }
+}
+
+void LNS::remove_path(const int i)
+{
+  auto &&path = paths[i];
+  for (size_t t = 0; t + 1 < path.size(); ++t) {
+    auto &&entries = table[path[t]->id];
+    const auto e = std::make_pair((int)t, i);
+    entries.erase(std::lower_bound(entries.begin(), entries.end(), e));
+  }
+}
+
+bool LNS::is_occupied(const Vertex *v, const int t,
+                      const std::vector<char> &removed,
+                      const Paths &overlay) const
+{
+  auto &&entries = table[v->id];
+  auto it = std::lower_bound(entries.begin(), entries.end(),
+                             std::make_pair(t, -1));
+  for (; it != entries.end() && it->first == t; ++it) {
+    if (!removed[it->second]) return true;
+  }
+  // staying at the goal
+  const auto j = goal_owner[v->id];
+  if (j != -1 && !removed[j] && (int)paths[j].size() - 1 <= t) return true;
+  for (auto &&q : overlay) {
+    if (q[std::min((size_t)t, q.size() - 1)] == v) return true;
+  }
+  return false;
+}
+
+bool LNS::is_swapped(const Vertex *from, const Vertex *to, const int t,
+                     const std::vector<char> &removed,
+                     const Paths &overlay) const
+{
+  auto &&entries = table[to->id];
+  auto it = std::lower_bound(entries.begin(), entries.end(),
+                             std::make_pair(t, -1));
+  for (; it != entries.end() && it->first == t; ++it) {
+    if (removed[it->second]) continue;
+    auto &&p = paths[it->second];
+    if (p[std::min((size_t)t + 1, p.size() - 1)] == from) return true;
+  }
+  for (auto &&q : overlay) {
+    if (q[std::min((size_t)t, q.size() - 1)] == to &&
+        q[std::min((size_t)t + 1, q.size() - 1)] == from) {
+      return true;
+    }
+  }
+  return false;
+}
+
+int LNS::get_last_use(const Vertex *v, const std::vector<char> &removed,
+                      const Paths &overlay) const
+{
+  auto last = -1;
+  auto &&entries = table[v->id];
+  for (auto it = entries.rbegin(); it != entries.rend(); ++it) {
+    if (removed[it->second]) continue;
+    last = it->first;
+    break;
+  }
+  for (auto &&q : overlay) {
+    for (int t = q.size() - 1; t > last; --t) {
+      if (q[t] != v) continue;
+      last = t;
+      break;
+    }
+  }
+  return last;
+}
+
+// 三种邻域：随机、与延迟最大的智能体路径相交的智能体、地图局部区域
+std::vector<int> LNS::get_neighborhood(const int type, std::mt19937 &MT) const
+{
+  const int N = ins->N;
+  const auto size = std::min(neighbor_size, N);
+  auto agents = std::vector<int>();
+  auto added = std::vector<char>(N, false);
+  auto add = [&](const int j) {
+    if (j == -1 || added[j] || (int)agents.size() >= size) return;
+    added[j] = true;
+    agents.push_back(j);
+  };
+  auto add_agents_at = [&](const Vertex *v) {
+    for (auto &&e : table[v->id]) add(e.second);
+    add(goal_owner[v->id]);
+  };
+
+  if (type == AGENT) {
+    // roulette over delays
+    auto delays = std::vector<int>(N);
+    auto total = 0;
+    for (auto i = 0; i < N; ++i) {
+      delays[i] = get_path_loss(paths[i]) - D->get(i, ins->starts[i]);
+      total += delays[i];
+    }
+    if (total > 0) {
+      auto r = get_random_int(MT, 0, total - 1);
+      auto a = 0;
+      while (r >= delays[a]) r -= delays[a++];
+      add(a);
+      for (auto v : paths[a]) add_agents_at(v);
+    }
+  } else if (type == MAP) {
+    auto OPEN = std::queue<Vertex *>();
+    auto CLOSED = std::unordered_set<int>();
+    auto v = ins->G.V[get_random_int(MT, 0, ins->G.size() - 1)];
+    OPEN.push(v);
+    CLOSED.insert(v->id);
+    while (!OPEN.empty() && (int)agents.size() < size) {
+      v = OPEN.front();
+      OPEN.pop();
+      add_agents_at(v);
+      for (auto u : v->neighbors) {
+        if (CLOSED.insert(u->id).second) OPEN.push(u);
+      }
+    }
+  }
+
+  // RANDOM, or filling up the others
+  if (size == N) {
+    for (auto i = 0; i < N; ++i) add(i);
+  }
+  while ((int)agents.size() < size) add(get_random_int(MT, 0, N - 1));
+  return agents;
+}
+
+// 移除邻域内智能体的路径，按随机顺序逐个重新规划
+LNSCandidate LNS::destroy_and_repair(const int k)
+{
+  auto &&MT = MTs[k];
+  auto c = LNSCandidate{RANDOM, {}, {}, 0};
+
+  // roulette over weights of neighborhoods
+  const auto total = std::accumulate(weights.begin(), weights.end(), 0.0);
+  if (total > 0) {
+    auto r = get_random_float(MT, 0, total);
+    while (c.type + 1 < NUM_NEIGHBORHOODS && r >= weights[c.type]) {
+      r -= weights[c.type++];
+    }
+  } else {
+    c.type = get_random_int(MT, 0, NUM_NEIGHBORHOODS - 1);
+  }
+  c.agents = get_neighborhood(c.type, MT);
+  std::shuffle(c.agents.begin(), c.agents.end(), MT);
+
+  auto removed = std::vector<char>(ins->N, false);
+  auto old_loss = 0;
+  auto rest_lb = 0;  // lower bound of agents not replanned yet
+  for (auto a : c.agents) {
+    removed[a] = true;
+    old_loss += get_path_loss(paths[a]);
+    rest_lb += D->get(a, ins->starts[a]);
+  }
+  auto checker = DeadlineChecker(deadline);
+  auto new_loss = 0;
+  for (auto a : c.agents) {
+    rest_lb -= D->get(a, ins->starts[a]);
+    // only paths improving the neighborhood are searched
+    auto path = find_path(a, removed, c.paths,
+                          old_loss - 1 - new_loss - rest_lb, checker);
+    if (path.empty()) {
+      c.paths.clear();
+      return c;
+    }
+    new_loss += get_path_loss(path);
+    c.paths.push_back(std::move(path));
+  }
+  c.gain = old_loss - new_loss;
+  return c;
+}
+
+// 时空 A*：代价为 loss，在目标处停留不计代价；最终停留须晚于他人最后一次经过目标
+Path LNS::find_path(const int i, const std::vector<char> &removed,
+                    const Paths &overlay, const int max_f,
+                    DeadlineChecker &checker) const
+{
+  struct Node {
+    Vertex *v;
+    int t;
+    int g;
+    int parent;
+  };
+  const auto s = ins->starts[i];
+  const auto goal = ins->goals[i];
+  const auto last_use = get_last_use(goal, removed, overlay);
+  const uint64_t K = ins->G.size();
+  if (D->get(i, s) > max_f) return Path();
+
+  auto nodes = std::vector<Node>({{s, 0, 0, -1}});
+  auto best = std::unordered_map<uint64_t, int>({{s->id, 0}});
+  using Entry = std::tuple<int, int, int>;  // f, h, node index
+  auto OPEN = std::priority_queue<Entry, std::vector<Entry>, std::greater<>>();
+  OPEN.emplace(D->get(i, s), D->get(i, s), 0);
+  while (!OPEN.empty()) {
+    if (checker.is_expired()) return Path();
+    const auto n = nodes[std::get<2>(OPEN.top())];
+    const auto n_idx = std::get<2>(OPEN.top());
+    OPEN.pop();
+    if (best[n.t * K + n.v->id] < n.g) continue;  // stale
+    if (n.v == goal && n.t > last_use) {
+      auto path = Path(n.t + 1);
+      for (auto k = n_idx; k != -1; k = nodes[k].parent) {
+        path[nodes[k].t] = nodes[k].v;
+      }
+      return path;
+    }
+
+    const auto t_next = n.t + 1;
+    auto expand = [&](Vertex *u) {
+      if (is_occupied(u, t_next, removed, overlay)) return;
+      if (u != n.v && is_swapped(n.v, u, n.t, removed, overlay)) return;
+      const auto g = n.g + ((n.v == goal && u == goal) ? 0 : 1);
+      const auto h = D->get(i, u);
+      if (g + h > max_f) return;
+      auto it = best.find(t_next * K + u->id);
+      if (it != best.end() && it->second <= g) return;
+      best[t_next * K + u->id] = g;
+      nodes.push_back({u, t_next, g, n_idx});
+      OPEN.emplace(g + h, h, nodes.size() - 1);
+    };
+    for (auto u : n.v->neighbors) expand(u);
+    expand(n.v);
+  }
+  return Path();
+}
+
+int LNS::apply(const LNSCandidate &c)
+{
+  if (c.paths.empty() || c.gain <= 0) return 0;
+  // neighborhoods of a round may share agents, the gain is measured again
+  auto gain = get_sum_of_loss_paths(c.paths);
+  for (auto a : c.agents) gain -= get_path_loss(paths[a]);
+  gain = -gain;
+  if (gain <= 0) return 0;
+  auto old_paths = Paths();
+  auto removed = std::vector<char>(ins->N, false);
+  for (auto a : c.agents) {
+    old_paths.push_back(paths[a]);
+    removed[a] = true;
+    remove_path(a);
+  }
+
+  // other candidates of the round may have been applied, check again
+  const auto none = Paths();
+  size_t k = 0;
+  for (; k < c.agents.size(); ++k) {
+    auto &&path = c.paths[k];
+    const auto T = path.size() - 1;
+    auto valid = get_last_use(path.back(), removed, none) < (int)T;
+    for (size_t t = 1; valid && t <= T; ++t) {
+      valid = !is_occupied(path[t], t, removed, none) &&
+              !is_swapped(path[t - 1], path[t], t - 1, removed, none);
+    }
+    if (!valid) break;
+    removed[c.agents[k]] = false;
+    add_path(c.agents[k], path);
+  }
+  if (k == c.agents.size()) return gain;
+
+  // rollback
+  for (size_t j = 0; j < k; ++j) remove_path(c.agents[j]);
+  for (size_t j = 0; j < c.agents.size(); ++j) {
+    add_path(c.agents[j], old_paths[j]);
+  }
+  return 0;
+}
+
+Solution LNS::optimize(const ImproveCallback &on_improve)
+{
+  info(1, verbose, deadline, "lns, sum_of_loss: ", sum_of_loss,
+       ", lower bound: ", lower_bound);
+  curve.emplace_back(elapsed_ms(deadline), sum_of_loss);
+  auto candidates = std::vector<LNSCandidate>(num_threads);
+  auto order = std::vector<int>(num_threads);
+  auto round = 0;
+  for (; round < MAX_ROUNDS && sum_of_loss > lower_bound &&
+         !is_expired(deadline);
+       ++round) {
+    pool.run(num_threads,
+             [&](int k, int) { candidates[k] = destroy_and_repair(k); });
+
+    // the largest gain first
+    std::iota(order.begin(), order.end(), 0);
+    std::stable_sort(order.begin(), order.end(), [&](int a, int b) {
+      return candidates[a].gain > candidates[b].gain;
+    });
+    auto improved = false;
+    for (auto k : order) {
+      auto &&c = candidates[k];
+      const auto gain = apply(c);
+      if (gain > 0) {
+        sum_of_loss -= gain;
+        improved = true;
+      }
+      if (c.agents.empty()) continue;
+      weights[c.type] =
+          REACTION * gain / c.agents.size() +
+          (1 - REACTION) * weights[c.type];
+    }
+    if (!improved) continue;
+    curve.emplace_back(elapsed_ms(deadline), sum_of_loss);
+    info(2, verbose, deadline, "lns, round: ", round,
+         ", sum_of_loss: ", sum_of_loss);
+    if (on_improve) on_improve(get_solution(), sum_of_loss);
+  }
+  info(1, verbose, deadline, "lns, rounds: ", round,
+       ", sum_of_loss: ", sum_of_loss);
+  return get_solution();
+}
@@ -2,20 +2,67 @@
 
 bool PIBT::SWAP = true;
 bool PIBT::HINDRANCE = true;
+bool PIBT::CLUSTER = false;
+int PIBT::NUM_THREADS = 1;
 
-PIBT::PIBT(const Instance *_ins, DistTable *_D, int seed)
+// distances are stored in 28 bits, i.e., graphs up to 2^28 vertices
+static constexpr uint64_t DIST_MAX = (uint64_t(1) << 28) - 1;
+
+static inline PIBTKey pack_key(const uint64_t dist, const uint64_t hindrance,
+                               const uint32_t tie, const int k)
+{
+  return (dist << 36) | (hindrance << 32) | tie | k;
+}
+
+static inline uint64_t make_tie_seed(uint64_t seed)
+{
+  return splitmix64(seed);
+}
+
+PIBT::PIBT(const Instance *_ins, DistTable *_D, int seed, int _num_threads)
     : ins(_ins),
       MT(seed),
-      rrd(0, 1),
+      tie_seed(make_tie_seed(seed)),
       N(ins->N),
       V_size(ins->G.size()),
       D(_D),
       NO_AGENT(N),
-      occupied_now(V_size, NO_AGENT),
-      occupied_next(V_size, NO_AGENT),
+      goal_owner(V_size, NO_AGENT),
+      unique_goals(true),
+      Q_from_now(nullptr),
+      epoch(0),
+      occupied_now(V_size, 0),
+      occupied_next(V_size, 0),
+      active_epoch(N, 0),
+      constrained_agents(),
       C_next(N),
-      C_indices(N)
+      C_indices(N),
+      num_threads(std::max(1, _num_threads)),
+      pool(nullptr),
+      scratches(1)
 {
+  for (auto i = 0; i < N; ++i) {
+    auto &&j = goal_owner[ins->goals[i]->id];
+    if (j != NO_AGENT) unique_goals = false;
+    j = i;
+  }
+
+  if (num_threads == 1) return;
+  if (!CLUSTER) {
+    warn("PIBT uses a single thread without the cluster mode");
+    return;
+  }
+  // lazy BFS modifies the distance table, thus it is not thread-safe
+  if (!D->OPEN.empty()) {
+    warn("parallel PIBT requires pre-computed distance tables");
+    return;
+  }
+  pool = std::make_unique<ThreadPool>(num_threads);
+  scratches.resize(num_threads);
+  claimed.assign(V_size, 0);
+  uf_parent.resize(N);
+  cluster_of.assign(N, 0);
+  cluster_members.resize(N);
 }
 
 PIBT::~PIBT() {}
@@ -23,90 +70,311 @@ PIBT::~PIBT() {}
 bool PIBT::set_new_config(const Config &Q_from, Config &Q_to,
                           const std::vector<int> &order)
 {
-  bool success = true;
-  // setup cache & constraints check
+  constrained_agents.clear();
+  for (auto i = 0; i < N; ++i) {
+    if (Q_to[i] != nullptr) constrained_agents.push_back(i);
+  }
+  return set_new_config(Q_from, Q_to, order, constrained_agents);
+}
+
+bool PIBT::set_new_config(const Config &Q_from, Config &Q_to,
+                          const std::vector<int> &order,
+                          const std::vector<int> &constrained)
+{
+  return set_new_config(Q_from, Q_to, order, constrained, order.size());
+}
+
+// 只对活跃智能体执行 PIBT；停在目标上的智能体仅在被推动、拉动或被约束挤占时处理
+bool PIBT::set_new_config(const Config &Q_from, Config &Q_to,
+                          const std::vector<int> &order,
+                          const std::vector<int> &constrained,
+                          const int num_active)
+{
+  // setup cache, entries of the previous call are invalidated by the epoch
+  next_epoch();
+  Q_from_now = &Q_from;
+  for (auto k = 0; k < num_active; ++k) {
+    set_occupied_now(Q_from[order[k]], order[k]);
+    active_epoch[order[k]] = epoch;
+  }
+  if (!unique_goals) {
+    for (auto i = 0; i < N; ++i) set_occupied_now(Q_from[i], i);
+  }
+
+  // constraints check
+  for (auto i : constrained) {
+    // vertex collision
+    if (get_occupied_next(Q_to[i]) != NO_AGENT) return false;
+    // swap collision
+    auto j = get_occupied_now(Q_to[i]);
+    if (j != NO_AGENT && j != i && Q_to[j] == Q_from[i]) return false;
+    set_occupied_next(Q_to[i], i);
+  }
+
+  // settled agents whose goals are taken by constraints have to move
+  displaced_agents.clear();
+  for (auto i : constrained) {
+    const auto j = get_occupied_now(Q_to[i]);
+    if (j != NO_AGENT && active_epoch[j] != epoch && Q_to[j] == nullptr) {
+      displaced_agents.push_back(j);
+    }
+  }
+
+  if (pool != nullptr) {
+    if (!set_new_config_clusters(Q_from, Q_to, order, num_active)) {
+      return false;
+    }
+  } else {
+    auto &&S = scratches[0];
+    for (auto k = 0; k < num_active; ++k) {
+      const auto i = order[k];
+      if (Q_to[i] == nullptr && !funcPIBT(i, Q_from, Q_to, S)) return false;
+    }
+    for (auto i : displaced_agents) {
+      if (Q_to[i] == nullptr && !funcPIBT(i, Q_from, Q_to, S)) return false;
+    }
+  }
+
+  // the others stay, and record agents leaving their goals
+  activated.clear();
+  for (auto i = 0; i < N; ++i) {
+    if (Q_to[i] == nullptr) {
+      Q_to[i] = Q_from[i];
+    } else if (Q_to[i] != Q_from[i] && Q_from[i] == ins->goals[i]) {
+      activated.push_back(i);
+    }
+  }
+  return true;
+}
+
+// 按邻域划分互不影响的智能体簇，各簇按 order 中的相对顺序并行执行 PIBT
+bool PIBT::set_new_config_clusters(const Config &Q_from, Config &Q_to,
+                                   const std::vector<int> &order,
+                                   const int num_active)
+{
+  // agent-i only touches its closed neighborhood, and agents located there;
+  // agents sharing a vertex of their neighborhoods belong to one cluster
+  const auto stamp = (uint64_t)epoch << 32;
+  for (auto i = 0; i < N; ++i) uf_parent[i] = i;
   for (auto i = 0; i < N; ++i) {
-    // set occupied now
-    occupied_now[Q_from[i]->id] = i;
-
-    // set occupied next
-    if (Q_to[i] != nullptr) {
-      // vertex collision
-      if (occupied_next[Q_to[i]->id] != NO_AGENT) {
-        success = false;
-        break;
+    for (auto u : Q_from[i]->actions) {
+      const auto x = claimed[u->id];
+      if ((x >> 32) != epoch) {
+        claimed[u->id] = stamp | (uint32_t)i;
+        continue;
       }
-      // swap collision
-      auto j = occupied_now[Q_to[i]->id];
-      if (j != NO_AGENT && j != i && Q_to[j] == Q_from[i]) {
-        success = false;
-        break;
+      const auto r_i = find_cluster_root(i);
+      const auto r_j = find_cluster_root((uint32_t)x);
+      if (r_i < r_j) {
+        uf_parent[r_j] = r_i;
+      } else if (r_j < r_i) {
+        uf_parent[r_i] = r_j;
       }
-      occupied_next[Q_to[i]->id] = i;
     }
   }
 
-  if (success) {
-    for (auto i : order) {
-      if (Q_to[i] == nullptr && !funcPIBT(i, Q_from, Q_to)) {
-        success = false;
-        break;
+  // number the clusters by their first agent in order, then bucket agents;
+  // agents are taken in the same sequence as the serial version
+  auto for_each_agent = [&](auto &&f) {
+    for (auto k = 0; k < num_active; ++k) f(order[k]);
+    for (auto i : displaced_agents) f(i);
+  };
+  auto num_clusters = 0;
+  cluster_start.assign(1, 0);
+  for_each_agent([&](const int i) {
+    if (Q_to[i] != nullptr) return;
+    const auto r = find_cluster_root(i);
+    if ((cluster_of[r] >> 32) != epoch) {
+      cluster_of[r] = stamp | (uint32_t)num_clusters++;
+      cluster_start.push_back(0);
+    }
+    ++cluster_start[(uint32_t)cluster_of[r] + 1];
+  });
+  if (num_clusters == 0) return true;
+  for (auto c = 0; c < num_clusters; ++c) {
+    cluster_start[c + 1] += cluster_start[c];
+  }
+  cluster_cursor.assign(cluster_start.begin(), cluster_start.end() - 1);
+  for_each_agent([&](const int i) {
+    if (Q_to[i] != nullptr) return;
+    const auto c = (uint32_t)cluster_of[find_cluster_root(i)];
+    cluster_members[cluster_cursor[c]++] = i;
+  });
+
+  // clusters are grouped into tasks to amortize scheduling costs;
+  // tasks are taken from the back, so that a missed dependency between
+  // clusters changes the result even without actual concurrency
+  const auto num_tasks = std::min(num_clusters, num_threads * 8);
+  std::atomic<bool> failed(false);
+  pool->run(num_tasks, [&](int task_id, int worker_id) {
+    auto &&S = scratches[worker_id];
+    const auto k = num_tasks - 1 - task_id;
+    const auto c_begin = (int64_t)num_clusters * k / num_tasks;
+    const auto c_end = (int64_t)num_clusters * (k + 1) / num_tasks;
+    for (auto idx = cluster_start[c_begin]; idx < cluster_start[c_end];
+         ++idx) {
+      const auto i = cluster_members[idx];
+      if (Q_to[i] == nullptr && !funcPIBT(i, Q_from, Q_to, S)) {
+        failed = true;
+        return;
       }
     }
+  });
+  return !failed;
+}
+
+int PIBT::find_cluster_root(int i)
+{
+  while (uf_parent[i] != i) {
+    uf_parent[i] = uf_parent[uf_parent[i]];  // path halving
+    i = uf_parent[i];
   }
+  return i;
+}
 
-  // cleanup
-  for (auto i = 0; i < N; ++i) {
-    occupied_now[Q_from[i]->id] = NO_AGENT;
-    if (Q_to[i] != nullptr) occupied_next[Q_to[i]->id] = NO_AGENT;
+void PIBT::next_epoch()
+{
+  ++epoch;
+  if (epoch == 0) {
+    // wrap around, clear all stamps
+    std::fill(occupied_now.begin(), occupied_now.end(), 0);
+    std::fill(occupied_next.begin(), occupied_next.end(), 0);
+    std::fill(active_epoch.begin(), active_epoch.end(), 0);
+    std::fill(claimed.begin(), claimed.end(), 0);
+    std::fill(cluster_of.begin(), cluster_of.end(), 0);
+    epoch = 1;
+  }
+}
+
+// 优先级继承的迭代实现：用显式栈代替递归，栈在多次调用之间复用
+bool PIBT::funcPIBT(const int i_root, const Config &Q_from, Config &Q_to,
+                    PIBTScratch &S)
+{
+  auto &&stack = S.stack;
+  stack.clear();
+  stack.push_back({i_root, 0, set_candidates(i_root, Q_from, Q_to, S), false});
+  auto res = false;  // result of the frame popped last
+
+  while (!stack.empty()) {
+    auto &f = stack.back();  // invalidated by push
+    const auto i = f.i;
+
+    // resume after priority inheritance
+    if (f.waiting) {
+      f.waiting = false;
+      if (res) {
+        // success to plan next one step
+        if (f.k == 0) swap_operation(i, f.swap_agent, Q_from, Q_to);
+        stack.pop_back();
+        continue;
+      }
+      ++f.k;
+    }
+
+    // main loop
+    const int K = Q_from[i]->actions.size();
+    auto j_inherit = NO_AGENT;
+    auto secured = false;
+    for (; f.k < K; ++f.k) {
+      auto u_idx = C_indices[i][f.k];
+      auto u = C_next[i][u_idx];
+
+      // avoid vertex conflicts
+      if (get_occupied_next(u) != NO_AGENT) continue;
+
+      const auto j = get_occupied_now(u);
+
+      // avoid swap conflicts with constraints
+      if (j != NO_AGENT && Q_to[j] == Q_from[i]) continue;
+
+      // reserve next location
+      set_occupied_next(u, i);
+      Q_to[i] = u;
+
+      // priority inheritance
+      if (j != NO_AGENT && u != Q_from[i] && Q_to[j] == nullptr) {
+        f.waiting = true;
+        j_inherit = j;
+      } else {
+        secured = true;
+      }
+      break;
+    }
+
+    if (j_inherit != NO_AGENT) {
+      const auto swap_agent = set_candidates(j_inherit, Q_from, Q_to, S);
+      stack.push_back({j_inherit, 0, swap_agent, false});
+      continue;
+    }
+
+    if (secured) {
+      // success to plan next one step
+      if (f.k == 0) swap_operation(i, f.swap_agent, Q_from, Q_to);
+      res = true;
+    } else {
+      // failed to secure node
+      set_occupied_next(Q_from[i], i);
+      Q_to[i] = Q_from[i];
+      res = false;
+    }
+    stack.pop_back();
   }
 
-  return success;
+  return res;
 }
 
-bool PIBT::funcPIBT(const int i, const Config &Q_from, Config &Q_to)
+int PIBT::set_candidates(const int i, const Config &Q_from, Config &Q_to,
+                         PIBTScratch &S)
 {
   const auto K = Q_from[i]->neighbors.size();
+  auto &&C_key = S.C_key;
+  auto &&neighbor_agents = S.neighbor_agents;
 
   // hindrance preparation
   int num_neighbor_agents = 0;
-  static std::array<int, 4> neighbor_agents;
   if (HINDRANCE) {
     for (auto u : Q_from[i]->neighbors) {
-      if (occupied_now[u->id] != NO_AGENT) {
-        neighbor_agents[num_neighbor_agents] = occupied_now[u->id];
+      const auto j = get_occupied_now(u);
+      if (j != NO_AGENT) {
+        neighbor_agents[num_neighbor_agents] = j;
         ++num_neighbor_agents;
       }
     }
   }
 
-  auto get_successor_cost = [&](Vertex *u, bool swap = false) {
-    auto e = rrd(MT);
-    if (swap) return std::make_tuple(-D->get(i, u), 0, e);
+  // in the cluster mode, tie-breaks depend only on (call, agent, action),
+  // hence the result is independent of the processing order of clusters
+  auto get_tie = [&](int k, bool swap) -> uint32_t {
+    if (!CLUSTER) return (uint32_t)MT();
+    auto x = tie_seed ^ ((uint64_t)epoch << 32) ^ ((uint64_t)i << 4) ^
+             ((uint64_t)k << 1) ^ (uint64_t)swap;
+    return (uint32_t)(splitmix64(x) >> 32);
+  };
+
+  auto get_successor_key = [&](Vertex *u, int k, bool swap = false) {
+    const auto e = get_tie(k, swap) & ~(uint32_t)7;
+    if (swap) return pack_key(DIST_MAX - D->get(i, u), 0, e, k);
 
     int hindrance = 0;
     if (HINDRANCE) {
-      for (auto k = 0; k < num_neighbor_agents; ++k) {
-        auto &&j = neighbor_agents[k];
+      for (auto l = 0; l < num_neighbor_agents; ++l) {
+        auto &&j = neighbor_agents[l];
         if (Q_from[j] != u && D->get(j, u) < D->get(j, Q_from[j])) {
           hindrance += 1;
         }
       }
     }
 
-    return std::make_tuple(D->get(i, u), hindrance, e);
+    return pack_key(D->get(i, u), hindrance, e, k);
   };
 
   // set C_next
   for (size_t k = 0; k <= K; ++k) {
     auto u = Q_from[i]->actions[k];
     C_next[i][k] = u;
-    C_cost[k] = get_successor_cost(u);
+    C_key[k] = get_successor_key(u, k);
   }
-  // sort, note: K + 1 is sufficient
-  std::iota(C_indices[i].begin(), C_indices[i].begin() + K + 1, 0);
-  std::sort(C_indices[i].begin(), C_indices[i].begin() + K + 1,
-            [&](const int k, const int l) { return C_cost[k] < C_cost[l]; });
+  rank_candidates(i, K + 1, S);
 
   // emulate swap
   const auto swap_agent = is_swap_required_and_possible(
@@ -114,55 +382,48 @@ bool PIBT::funcPIBT(const int i, const Config &Q_from, Config &Q_to)
   if (swap_agent != NO_AGENT) {
     // recompute action cost
     for (size_t k = 0; k < K + 1; ++k) {
-      C_cost[k] = get_successor_cost(C_next[i][k], true);
-      C_indices[i][k] = k;
+      C_key[k] = get_successor_key(C_next[i][k], k, true);
     }
-    std::sort(C_indices[i].begin(), C_indices[i].begin() + K + 1,
-              [&](const int k, const int l) { return C_cost[k] < C_cost[l]; });
+    rank_candidates(i, K + 1, S);
   }
-  auto swap_operation = [&]() {
-    if (swap_agent != NO_AGENT &&                 // swap_agent exists
-        Q_to[swap_agent] == nullptr &&            // not decided
-        occupied_next[Q_from[i]->id] == NO_AGENT  // free
-    ) {
-      // pull swap_agent
-      occupied_next[Q_from[i]->id] = swap_agent;
-      Q_to[swap_agent] = Q_from[i];
-    }
-  };
-
-  // main loop
-  for (size_t k = 0; k < K + 1; ++k) {
-    auto u_idx = C_indices[i][k];
-    auto u = C_next[i][u_idx];
-
-    // avoid vertex conflicts
-    if (occupied_next[u->id] != NO_AGENT) continue;
-
-    const auto j = occupied_now[u->id];
-
-    // avoid swap conflicts with constraints
-    if (j != NO_AGENT && Q_to[j] == Q_from[i]) continue;
-
-    // reserve next location
-    occupied_next[u->id] = i;
-    Q_to[i] = u;
+  return swap_agent;
+}
 
-    // priority inheritance
-    if (j != NO_AGENT && u != Q_from[i] && Q_to[j] == nullptr &&
-        !funcPIBT(j, Q_from, Q_to)) {
-      continue;
-    }
+// 5 输入排序网络（9 次比较交换，无分支），未使用的位置填充最大值
+void PIBT::rank_candidates(const int i, const int num_candidates,
+                           PIBTScratch &S)
+{
+  auto &&C_key = S.C_key;
+  for (auto k = num_candidates; k < 5; ++k) C_key[k] = UINT64_MAX;
+  auto cmp_swap = [&](const int a, const int b) {
+    const auto lo = std::min(C_key[a], C_key[b]);
+    const auto hi = std::max(C_key[a], C_key[b]);
+    C_key[a] = lo;
+    C_key[b] = hi;
+  };
+  cmp_swap(0, 3);
+  cmp_swap(1, 4);
+  cmp_swap(0, 2);
+  cmp_swap(1, 3);
+  cmp_swap(0, 1);
+  cmp_swap(2, 4);
+  cmp_swap(1, 2);
+  cmp_swap(3, 4);
+  cmp_swap(2, 3);
+  for (auto k = 0; k < num_candidates; ++k) C_indices[i][k] = C_key[k] & 7;
+}
 
-    // success to plan next one step
-    if (k == 0) swap_operation();
-    return true;
+void PIBT::swap_operation(const int i, const int swap_agent,
+                          const Config &Q_from, Config &Q_to)
+{
+  if (swap_agent != NO_AGENT &&                 // swap_agent exists
+      Q_to[swap_agent] == nullptr &&            // not decided
+      get_occupied_next(Q_from[i]) == NO_AGENT  // free
+  ) {
+    // pull swap_agent
+    set_occupied_next(Q_from[i], swap_agent);
+    Q_to[swap_agent] = Q_from[i];
   }
-
-  // failed to secure node
-  occupied_next[Q_from[i]->id] = i;
-  Q_to[i] = Q_from[i];
-  return false;
 }
 
 int PIBT::is_swap_required_and_possible(const int i, const Config &Q_from,
@@ -170,7 +431,7 @@ int PIBT::is_swap_required_and_possible(const int i, const Config &Q_from,
 {
   if (!SWAP) return NO_AGENT;
   // agent-j occupying the desired vertex for agent-i
-  const auto j = occupied_now[v_i_target->id];
+  const auto j = get_occupied_now(v_i_target);
   if (j != NO_AGENT && j != i &&  // j exists
       Q_to[j] == nullptr &&       // j does not decide next location
       is_swap_required(i, j, Q_from[i], Q_from[j]) &&  // swap required
@@ -182,7 +443,7 @@ int PIBT::is_swap_required_and_possible(const int i, const Config &Q_from,
   // for clear operation, c.f., push & swap
   if (v_i_target != Q_from[i]) {
     for (auto u : Q_from[i]->neighbors) {
-      const auto k = occupied_now[u->id];
+      const auto k = get_occupied_now(u);
       if (k != NO_AGENT &&            // k exists
           v_i_target != Q_from[k] &&  // this is for clear operation
           is_swap_required(k, i, Q_from[i],
@@ -205,7 +466,7 @@ bool PIBT::is_swap_required(const int pusher, const int puller,
     auto n = v_puller->neighbors.size();
     // remove agents who need not to move
     for (auto u : v_puller->neighbors) {
-      const auto i = occupied_now[u->id];
+      const auto i = get_occupied_now(u);
       if (u == v_pusher ||
           (u->neighbors.size() == 1 && i != NO_AGENT && ins->goals[i] == u)) {
         --n;
@@ -233,7 +494,7 @@ bool PIBT::is_swap_possible(Vertex *v_pusher_origin, Vertex *v_puller_origin)
   while (v_puller != v_pusher_origin) {  // avoid loop
     auto n = v_puller->neighbors.size();
     for (auto u : v_puller->neighbors) {
-      const auto i = occupied_now[u->id];
+      const auto i = get_occupied_now(u);
       if (u == v_pusher ||
           (u->neighbors.size() == 1 && i != NO_AGENT && ins->goals[i] == u)) {
         --n;
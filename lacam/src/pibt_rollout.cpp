@@ -0,0 +1,108 @@
+#include "../include/pibt_rollout.hpp"
+
+int PIBTRollout::MAX_TIMESTEP = 100000;
+
+PIBTRollout::PIBTRollout(const Instance *_ins, DistTable *_D, int _verbose,
+                         const Deadline *_deadline, int _seed,
+                         int num_threads)
+    : ins(_ins),
+      D(_D),
+      deadline(_deadline),
+      verbose(_verbose),
+      pibt(ins, D, _seed, num_threads),
+      Q_from(ins->N, nullptr),
+      Q_to(ins->N, nullptr),
+      priorities(ins->N, 0),
+      order(),
+      order_next(),
+      last_off_goal(ins->N, -1),
+      max_timestep(MAX_TIMESTEP)
+{
+}
+
+PIBTRollout::~PIBTRollout() {}
+
+// 反复调用 PIBT 生成下一步配置，直到所有智能体到达目标或达到步数上限
+RolloutStats PIBTRollout::run(
+    const Config &Q_init,
+    const std::function<void(int, const Config &)> &on_step)
+{
+  const int N = ins->N;
+  auto stats = RolloutStats{false, 0, 0, 0, 0, 0};
+  Q_from = Q_init;
+  for (auto i = 0; i < N; ++i) {
+    const auto d = D->get(i, Q_from[i]);
+    stats.makespan_lb = std::max(stats.makespan_lb, d);
+    stats.sum_of_costs_lb += d;
+  }
+  std::fill(last_off_goal.begin(), last_off_goal.end(), -1);
+  update_priorities(Q_from, true);
+  const auto no_constraints = std::vector<int>();
+
+  for (int t = 0;; ++t) {
+    on_step(t, Q_from);
+
+    // check goal condition & update metrics, order holds unsettled agents
+    for (auto i : order) last_off_goal[i] = t;
+    if (order.empty()) {
+      stats.solved = true;
+      break;
+    }
+    if (t >= max_timestep || is_expired(deadline)) {
+      info(1, verbose, deadline, "rollout stopped at timestep ", t,
+           ", arrived: ", N - order.size(), "/", N);
+      break;
+    }
+
+    // one-step planning
+    std::fill(Q_to.begin(), Q_to.end(), nullptr);
+    if (!pibt.set_new_config(Q_from, Q_to, order, no_constraints,
+                             order.size())) {
+      info(1, verbose, deadline, "PIBT failed at timestep ", t);
+      break;
+    }
+    stats.sum_of_loss += order.size() + pibt.activated.size();
+    std::swap(Q_from, Q_to);
+    update_priorities(Q_from, false);
+    stats.makespan = t + 1;
+  }
+
+  for (auto i = 0; i < N; ++i) stats.sum_of_costs += last_off_goal[i] + 1;
+  info(1, verbose, deadline, "rollout ends, solved: ", stats.solved,
+       ", makespan: ", stats.makespan);
+  return stats;
+}
+
+Solution PIBTRollout::solve()
+{
+  auto solution = Solution();
+  auto stats =
+      run(ins->starts, [&](int, const Config &Q) { solution.push_back(Q); });
+  if (!stats.solved) solution.clear();
+  return solution;
+}
+
+// 与 HNode 相同的动态优先级：未到达目标则 +1，到达则只保留小数部分；
+// 只更新上一步的活跃智能体以及离开目标的智能体
+void PIBTRollout::update_priorities(const Config &Q, const bool init)
+{
+  const int N = ins->N;
+  if (init) {
+    order.clear();
+    for (auto i = 0; i < N; ++i) {
+      const auto d = D->get(i, Q[i]);
+      priorities[i] = d;
+      if (d != 0) order.push_back(i);
+    }
+    auto cmp = [&](int i, int j) {
+      return has_higher_priority(priorities, i, j);
+    };
+    std::sort(order.begin(), order.end(), cmp);
+    return;
+  }
+  update_active_order(
+      order.data(), order.data() + order.size(), pibt.activated,
+      [&](const int i) { return Q[i] != ins->goals[i]; }, priorities,
+      order_next);
+  std::swap(order, order_next);
+}
@@ -2,16 +2,210 @@
 
 // 利用给定的实例（Instance），使用距离表（DistTable）和 LaCAM 算法，计算并返回一个解（Solution）。
 Solution solve(const Instance &ins, int verbose, const Deadline *deadline,
-               int seed)
-{
-  // distance table
-  auto D = DistTable(ins);
-  info(1, verbose, deadline,
-       "set distance table, multi-thread init: ", DistTable::MULTI_THREAD_INIT);
-
-  // lacam
-  auto lacam = LaCAM(&ins, &D, verbose, deadline, seed);
-  info(1, verbose, deadline, "start lacam");
-  // return lacam.solve();
-  return lacam.solve_beam();
+               int seed, MemoryBudget *budget,
+               const ImproveCallback &on_improve, DistTable *D)
+{
+  // parallel search requires the full distance table, lazy BFS is not shared;
+  // decided per call, the static defaults are left untouched
+  const auto parallel = ParallelLaCAM::NUM_THREADS > 1;
+  auto precompute = DistTable::MULTI_THREAD_INIT;
+  if (parallel && !precompute) {
+    warn("parallel LaCAM requires pre-computed distance tables");
+    precompute = true;
+  }
+  if (PIBT::NUM_THREADS > 1 && !precompute) {
+    warn("parallel PIBT requires pre-computed distance tables");
+    precompute = true;
+  }
+  if (LaCAM::BATCH_SIZE > 1 && !precompute) {
+    warn("batched expansion requires pre-computed distance tables");
+    precompute = true;
+  }
+  auto decompose = Decomposition::ENABLED;
+  if (decompose &&
+      !(LaCAM::CHECKPOINT_FILE.empty() && LaCAM::RESUME_FILE.empty())) {
+    warn("decomposition does not support checkpoints, disabled");
+    decompose = false;
+  }
+
+  // distance table, unless the caller keeps one
+  auto D_own = std::unique_ptr<DistTable>();
+  if (D == nullptr) {
+    D_own = std::make_unique<DistTable>(ins, deadline, precompute);
+    D = D_own.get();
+    info(1, verbose, deadline, "set distance table, multi-thread init: ",
+         precompute);
+  }
+  const auto table_bytes = D->memory_usage();
+  if (budget != nullptr) budget->allocate(table_bytes);
+
+  auto solution = Solution();
+  if (is_expired(deadline)) {
+    // the partial table is lazy and not thread-safe, no time to search anyway
+    info(1, verbose, deadline, "deadline passed while setting distance table");
+  } else if (parallel) {
+    auto lacam = ParallelLaCAM(&ins, D, verbose, deadline, seed,
+                               ParallelLaCAM::NUM_THREADS, budget, on_improve);
+    info(1, verbose, deadline, "start parallel lacam");
+    solution = lacam.solve();
+  } else {
+    // independent groups of agents first, joint search as the fallback
+    if (decompose) {
+      auto decomposition = Decomposition(&ins, D);
+      solution = decomposition.solve(verbose, deadline, seed, budget);
+      if (!solution.empty() && on_improve) {
+        on_improve(solution, get_sum_of_loss(solution));
+      }
+    }
+    if (solution.empty()) {
+      // lacam
+      auto lacam =
+          LaCAM(&ins, D, verbose, deadline, seed, budget, on_improve);
+      info(1, verbose, deadline, "start lacam");
+      // solution = lacam.solve();
+      solution = lacam.solve_beam();
+    }
+  }
+
+  if (budget != nullptr) budget->deallocate(table_bytes);
+  return solution;
+}
+
+double BackgroundRefinement::STOP_CHECK_US = 1000;
+
+BackgroundRefinement::BackgroundRefinement(const Instance &_ins,
+                                           const int _verbose,
+                                           const Deadline *_deadline, int seed,
+                                           MemoryBudget *_budget,
+                                           const ImproveCallback &_on_improve)
+    : ins(&_ins),
+      verbose(_verbose),
+      deadline(_deadline),
+      budget(_budget),
+      D(_ins, deadline),
+      table_bytes(D.memory_usage()),
+      handle(),
+      on_improve(_on_improve),
+      lacam(ins, &D, verbose, deadline, seed, budget,
+            [this](const Solution &solution, const int cost) {
+              handle.update(solution, cost);
+              if (on_improve) on_improve(solution, cost);
+            }),
+      stopping(false),
+      refining(false),
+      worker()
+{
+  lacam.anytime = true;  // this solver only, LaCAM::ANYTIME is kept
+  if (budget != nullptr) budget->allocate(table_bytes);
+}
+
+BackgroundRefinement::~BackgroundRefinement()
+{
+  stop();
+  if (budget != nullptr) budget->deallocate(table_bytes);
+}
+
+// 在调用线程中搜索到第一个解，之后在后台线程中继续同一搜索
+Solution BackgroundRefinement::start()
+{
+  if (is_expired(deadline)) {
+    info(1, verbose, deadline, "deadline passed while setting distance table");
+    return Solution();
+  }
+  info(1, verbose, deadline, "start lacam, refinement in background");
+  lacam.solver_info(1, "LaCAM begins");
+  lacam.init();
+  auto running = true;
+  while (lacam.H_goal == nullptr && running) running = lacam.step(1);
+  auto solution = lacam.result();
+  if (!running) return solution;  // nothing to refine
+
+  // the thread is the only user of lacam from here
+  refining = true;
+  worker = std::thread([this]() {
+    while (!stopping && lacam.step(INT_MAX, STOP_CHECK_US)) {
+    }
+    refining = false;
+  });
+  return solution;
+}
+
+void BackgroundRefinement::join()
+{
+  if (worker.joinable()) worker.join();
+}
+
+void BackgroundRefinement::stop()
+{
+  stopping = true;
+  join();
+}
+
+bool BackgroundRefinement::is_running() const
+{
+  return refining;
+}
+
+// 将地图划分为区域，各区域并行运行 PIBT，并在边界交接智能体
+Solution solve_regions(const Instance &ins, int verbose,
+                       const Deadline *deadline, int seed)
+{
+  if (PIBT::NUM_THREADS > 1) {
+    warn("regions are planned in parallel, PIBT in each region is sequential");
+  }
+  auto planner = RegionPlanner(&ins, verbose, deadline, seed);
+  return planner.solve();
+}
+
+// 多个子进程以不同种子求解，共享只读的距离表
+Solution solve_portfolio(const Instance &ins, int verbose,
+                         const Deadline *deadline, int seed,
+                         MemoryBudget *budget, const ImproveCallback &on_improve)
+{
+  if (!(LaCAM::CHECKPOINT_FILE.empty() && LaCAM::RESUME_FILE.empty())) {
+    warn("portfolio does not support checkpoints, disabled");
+  }
+  auto portfolio = Portfolio(&ins, verbose, deadline, seed, budget, on_improve);
+  return portfolio.solve();
+}
+
+// 用 LNS 改进已有的解，需要完整的距离表以供多线程读取
+Solution optimize_lns(const Instance &ins, const Solution &solution,
+                      int verbose, const Deadline *deadline, int seed,
+                      QualityCurve *curve, const ImproveCallback &on_improve,
+                      DistTable *D)
+{
+  if (solution.empty()) return solution;
+  auto D_own = std::unique_ptr<DistTable>();
+  if (D == nullptr) {
+    D_own = std::make_unique<DistTable>(ins, deadline, true);
+    D = D_own.get();
+  }
+  if (!D->OPEN.empty()) {
+    info(1, verbose, deadline, "deadline passed while setting distance table");
+    return solution;
+  }
+  auto lns = LNS(&ins, D, solution, verbose, deadline, seed);
+  auto improved = lns.optimize(on_improve);
+  if (curve != nullptr) *curve = lns.curve;
+  return improved;
+}
+
+RolloutStats solve_pibt(const Instance &ins,
+                        const std::function<void(int, const Config &)> &on_step,
+                        const int verbose, const Deadline *deadline, int seed)
+{
+  auto precompute = DistTable::MULTI_THREAD_INIT;
+  if (PIBT::NUM_THREADS > 1 && !precompute) {
+    warn("parallel PIBT requires pre-computed distance tables");
+    precompute = true;
+  }
+
+  auto D = DistTable(ins, deadline, precompute);
+  info(1, verbose, deadline, "set distance table, multi-thread init: ",
+       precompute);
+
+  auto rollout = PIBTRollout(&ins, &D, verbose, deadline, seed);
+  info(1, verbose, deadline, "start pibt rollout");
+  return rollout.run(ins.starts, on_step);
 }
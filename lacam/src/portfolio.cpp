@@ -0,0 +1,259 @@
+#include "../include/portfolio.hpp"
+
+#include <sched.h>
+#include <sys/mman.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include <cerrno>
+#include <limits>
+
+int Portfolio::NUM_PROCESSES = 4;
+float Portfolio::TARGET_RATIO = 0;
+bool Portfolio::PIN_CPUS = false;
+double Portfolio::SLOT_MB = 256;
+double Portfolio::POLL_MS = 1;
+
+PortfolioSlot::PortfolioSlot()
+    : mutex(),
+      writing(false),
+      cost(-1),
+      version(0),
+      process(-1),
+      dropped(0),
+      memory_peak(0),
+      memory_status(MemoryBudget::OK),
+      cancel(),
+      length(0)
+{
+  pthread_mutexattr_t attr;
+  pthread_mutexattr_init(&attr);
+  pthread_mutexattr_setpshared(&attr, PTHREAD_PROCESS_SHARED);
+  pthread_mutexattr_setrobust(&attr, PTHREAD_MUTEX_ROBUST);
+  pthread_mutex_init(&mutex, &attr);
+  pthread_mutexattr_destroy(&attr);
+}
+
+PortfolioSlot::~PortfolioSlot() { pthread_mutex_destroy(&mutex); }
+
+Portfolio::Portfolio(const Instance *_ins, int _verbose,
+                     const Deadline *_deadline, int _seed,
+                     MemoryBudget *_budget, const ImproveCallback &_on_improve)
+    : ins(_ins),
+      verbose(_verbose),
+      deadline(_deadline),
+      seed(_seed),
+      budget(_budget),
+      on_improve(_on_improve),
+      D(ins, deadline, true),  // complete table, children only read it
+      table_bytes(D.memory_usage()),
+      slot_bytes(std::max(SLOT_MB * 1024 * 1024,
+                          (double)sizeof(PortfolioSlot))),
+      capacity(0),
+      slot(nullptr),
+      plan(nullptr),
+      children()
+{
+  static_assert(std::atomic<int>::is_always_lock_free);
+  auto p = mmap(nullptr, slot_bytes, PROT_READ | PROT_WRITE,
+                MAP_SHARED | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+  if (p == MAP_FAILED) return;
+  slot = new (p) PortfolioSlot();
+  plan = reinterpret_cast<uint32_t *>(static_cast<char *>(p) +
+                                      sizeof(PortfolioSlot));
+  capacity = (slot_bytes - sizeof(PortfolioSlot)) /
+             (sizeof(uint32_t) * std::max(1u, ins->N));
+  if (budget != nullptr) budget->allocate(table_bytes);
+}
+
+Portfolio::~Portfolio()
+{
+  if (budget != nullptr) budget->deallocate(table_bytes);
+  if (slot == nullptr) return;
+  slot->~PortfolioSlot();
+  munmap(slot, slot_bytes);
+}
+
+// 复制解到共享内存，仅当其代价更小
+bool Portfolio::publish(const Solution &solution, const int k)
+{
+  if (solution.empty()) return false;
+  if (solution.size() > capacity) {
+    ++slot->dropped;  // reported by the coordinator
+    return false;
+  }
+  const auto cost = get_sum_of_loss(solution);
+  lock();
+  const auto best = slot->cost.load();
+  const auto improved = best < 0 || cost < best;
+  if (improved) {
+    slot->writing = true;
+    for (size_t t = 0; t < solution.size(); ++t) {
+      for (size_t i = 0; i < ins->N; ++i) {
+        plan[t * ins->N + i] = solution[t][i]->id;
+      }
+    }
+    slot->length = solution.size();
+    slot->process = k;
+    slot->cost = cost;
+    slot->writing = false;
+    ++slot->version;
+  }
+  unlock();
+  return improved;
+}
+
+int Portfolio::read(Solution &solution)
+{
+  lock();
+  const auto cost = slot->cost.load();
+  solution.clear();
+  for (auto t = 0; cost >= 0 && t < slot->length; ++t) {
+    solution.emplace_back(ins->N);
+    for (size_t i = 0; i < ins->N; ++i) {
+      solution[t][i] = ins->G.V[plan[t * ins->N + i]];
+    }
+  }
+  unlock();
+  return cost;
+}
+
+// 持锁的进程死亡时接管锁；若它正在写入，丢弃写了一半的计划
+void Portfolio::lock()
+{
+  if (pthread_mutex_lock(&slot->mutex) != EOWNERDEAD) return;
+  if (slot->writing) {
+    slot->writing = false;
+    slot->cost = -1;
+    slot->length = 0;
+    ++slot->version;
+  }
+  pthread_mutex_consistent(&slot->mutex);
+}
+
+void Portfolio::unlock() { pthread_mutex_unlock(&slot->mutex); }
+
+// 子进程：以不同的随机种子运行 LaCAM，结果写入共享内存后退出
+void Portfolio::run_child(const int k)
+{
+  if (PIN_CPUS) {
+    const auto num_cpus = std::max(1l, sysconf(_SC_NPROCESSORS_ONLN));
+    cpu_set_t cpus;
+    CPU_ZERO(&cpus);
+    CPU_SET(k % num_cpus, &cpus);
+    sched_setaffinity(0, sizeof(cpus), &cpus);
+  }
+  // stopped by the coordinator, which handles SIGINT as well
+  const auto time_limit_ms =
+      deadline == nullptr
+          ? std::numeric_limits<double>::max()
+          : std::max(deadline->time_limit_ms - deadline->elapsed_ms(), 1.0);
+  const auto child_deadline = Deadline(time_limit_ms, &slot->cancel);
+  // an equal share of the memory left by the table, 0 -> unlimited
+  const auto share_mb =
+      (budget == nullptr || budget->limit == 0)
+          ? 0
+          : std::max<size_t>(budget->get_remaining() / NUM_PROCESSES, 1) /
+                1024.0 / 1024.0;
+  auto child_budget = MemoryBudget(share_mb);
+  {
+    auto lacam = LaCAM(ins, &D, 0, &child_deadline, seed + k, &child_budget,
+                       [&](const Solution &solution, const int) {
+                         publish(solution, k);
+                       });
+    // children would write the same file
+    lacam.checkpoint_file.clear();
+    lacam.resume_file.clear();
+    publish(lacam.solve_beam(), k);
+  }
+  slot->memory_peak += child_budget.peak;
+  auto status = slot->memory_status.load();
+  while (status < child_budget.status &&
+         !slot->memory_status.compare_exchange_weak(status,
+                                                    child_budget.status)) {
+  }
+  _exit(0);  // no destructors or atexit handlers of the coordinator
+}
+
+Solution Portfolio::solve()
+{
+  if (slot == nullptr) {
+    info(1, verbose, deadline, "portfolio, failed to map shared memory");
+    return Solution();
+  }
+  if (!D.OPEN.empty()) {
+    info(1, verbose, deadline, "deadline passed while setting distance table");
+    return Solution();
+  }
+  const auto lower_bound = get_sum_of_costs_lower_bound(*ins, D);
+  const int target = TARGET_RATIO > 0 ? TARGET_RATIO * lower_bound : -1;
+  info(1, verbose, deadline, "portfolio, processes: ", NUM_PROCESSES,
+       ", lower bound: ", lower_bound, ", target: ", target);
+
+  std::cout.flush();
+  std::cerr.flush();
+  for (auto k = 0; k < NUM_PROCESSES; ++k) {
+    const auto pid = fork();
+    if (pid == 0) run_child(k);
+    if (pid < 0) {
+      warn("portfolio: fork failed");
+      break;
+    }
+    children.push_back(pid);
+  }
+
+  // wait for children, stop them at the target or the deadline
+  auto alive = children.size();
+  auto version = 0;
+  while (alive > 0) {
+    for (auto &&pid : children) {
+      if (pid <= 0) continue;
+      auto status = 0;
+      if (waitpid(pid, &status, WNOHANG) != pid) continue;
+      if (!WIFEXITED(status)) warn("portfolio: a process was terminated");
+      pid = -1;
+      --alive;
+    }
+    if (slot->version != version) {
+      version = slot->version;
+      info(2, verbose, deadline, "process ", slot->process.load(),
+           " published sum_of_loss: ", slot->cost.load());
+      if (on_improve) {
+        auto solution = Solution();
+        const auto cost = read(solution);
+        if (cost >= 0) on_improve(solution, cost);
+      }
+    }
+    if (!slot->cancel.is_cancelled()) {
+      const auto cost = slot->cost.load();
+      if (cost >= 0 && cost <= target) {
+        info(1, verbose, deadline, "portfolio, target reached");
+        slot->cancel.cancel();
+      } else if (is_expired(deadline)) {
+        slot->cancel.cancel();
+      }
+    }
+    if (alive > 0) {
+      std::this_thread::sleep_for(
+          std::chrono::microseconds((int)(POLL_MS * 1000)));
+    }
+  }
+  children.clear();
+  if (slot->dropped > 0) {
+    warn("portfolio: ", slot->dropped.load(), " plans longer than ", capacity,
+         " timesteps did not fit the slot, increase SLOT_MB");
+  }
+  if (budget != nullptr) {
+    budget->allocate(slot->memory_peak);  // children ran concurrently
+    budget->deallocate(slot->memory_peak);
+    budget->degrade((MemoryBudget::Status)slot->memory_status.load());
+  }
+
+  auto solution = Solution();
+  const auto cost = read(solution);
+  if (cost >= 0) {
+    info(1, verbose, deadline, "portfolio, best by process ",
+         slot->process.load(), ", sum_of_loss: ", cost);
+  }
+  return solution;
+}
@@ -94,69 +94,45 @@ void print_stats(const int verbose, const Deadline *deadline,
        "\tsum_of_costs: ", sum_of_costs, " (lb=", sum_of_costs_lb,
        ", ub=", ceil((float)sum_of_costs / sum_of_costs_lb), ")",
        "\tsum_of_loss: ", sum_of_loss, " (lb=", sum_of_costs_lb,
-       ", ub=", ceil((float)sum_of_loss / sum_of_costs_lb), ")");
+       ", ub=", ceil((float)sum_of_loss / sum_of_costs_lb), ")",
+       "\tpeak_mem_mb: ", get_peak_memory_mb());
+}
+
+void print_stats(const int verbose, const Deadline *deadline,
+                 const RolloutStats &stats, const double comp_time_ms)
+{
+  auto ceil = [](float x) { return std::ceil(x * 100) / 100; };
+  const auto makespan_lb = std::max(stats.makespan_lb, 1);
+  const auto sum_of_costs_lb = std::max(stats.sum_of_costs_lb, 1);
+  info(1, verbose, deadline, stats.solved ? "solved" : "unsolved",
+       "\tcomp_time_ms: ", comp_time_ms,
+       "\tmakespan: ", stats.makespan, " (lb=", stats.makespan_lb,
+       ", ub=", ceil((float)stats.makespan / makespan_lb), ")",
+       "\tsum_of_costs: ", stats.sum_of_costs, " (lb=", stats.sum_of_costs_lb,
+       ", ub=", ceil((float)stats.sum_of_costs / sum_of_costs_lb), ")",
+       "\tsum_of_loss: ", stats.sum_of_loss, " (lb=", stats.sum_of_costs_lb,
+       ", ub=", ceil((float)stats.sum_of_loss / sum_of_costs_lb), ")",
+       "\tpeak_mem_mb: ", get_peak_memory_mb());
 }
 
 
 // for log of map_name
 static const std::regex r_map_name = std::regex(R"(.+/(.+))");
 
-
-// 将多智能体路径规划（MAPF）实验结果写入日志文件
-void make_log(const Instance &ins, const Solution &solution,
-              const std::string &output_name, const double comp_time_ms,
-              const std::string &map_name, const std::string &scen_name, const int seed, const bool log_short)
+static std::string get_map_recorded_name(const std::string &map_name)
 {
-  // map name
   std::smatch results;
-  const auto map_recorded_name =
-      (std::regex_match(map_name, results, r_map_name)) ? results[1].str()
-                                                        : map_name;
-
-  // for instance-specific values
-  auto dist_table = DistTable(ins);
-
-  // log for visualizer
-  auto get_x = [&](int k) { return k % ins.G.width; };
-  auto get_y = [&](int k) { return k / ins.G.width; };
-  std::ofstream log;
-  log.open(output_name, std::ios::out);
-  log << "agents=" << ins.N << "\n";
-  log << "map_file=" << map_recorded_name << "\n";
-  log << "solver=planner\n";
-  log << "solved=" << !solution.empty() << "\n";
-  log << "soc=" << get_sum_of_costs(solution) << "\n";
-  log << "soc_lb=" << get_sum_of_costs_lower_bound(ins, dist_table) << "\n";
-  log << "makespan=" << get_makespan(solution) << "\n";
-  log << "makespan_lb=" << get_makespan_lower_bound(ins, dist_table) << "\n";
-  log << "sum_of_loss=" << get_sum_of_loss(solution) << "\n";
-  log << "sum_of_loss_lb=" << get_sum_of_costs_lower_bound(ins, dist_table)
-      << "\n";
-  log << "comp_time=" << comp_time_ms << "\n";
-  log << "seed=" << seed << "\n";
-  if (log_short) return;
-  log << "starts=";
-  for (size_t i = 0; i < ins.N; ++i) {
-    auto k = ins.starts[i]->index;
-    log << "(" << get_x(k) << "," << get_y(k) << "),";
-  }
-  log << "\ngoals=";
-  for (size_t i = 0; i < ins.N; ++i) {
-    auto k = ins.goals[i]->index;
-    log << "(" << get_x(k) << "," << get_y(k) << "),";
-  }
-  log << "\nsolution=\n";
-  for (size_t t = 0; t < solution.size(); ++t) {
-    log << t << ":";
-    auto C = solution[t];
-    for (auto v : C) {
-      log << "(" << get_x(v->index) << "," << get_y(v->index) << "),";
-    }
-    log << "\n";
-  }
-  log.close();
+  return (std::regex_match(map_name, results, r_map_name)) ? results[1].str()
+                                                           : map_name;
+}
 
-  // save result to csv
+// 将一行实验结果追加到 csv 文件
+static void append_csv(const Instance &ins, const std::string &map_recorded_name,
+                       const std::string &scen_name,
+                       const std::string &solver_name,
+                       const size_t total_cost_disappear_at_goal,
+                       const double comp_time_ms)
+{
   std::string to_csv_path = "experimental_results.csv";
   std::ofstream to_csv(to_csv_path, std::ios::app);  // 以追加模式打开文件
   if (!to_csv.is_open()) {
@@ -179,13 +155,12 @@ void make_log(const Instance &ins, const Solution &solution,
   to_csv << "Unknown" << ","; // device
 #endif
 
-  to_csv << "Lacam" << ","; // high level solver name
+  to_csv << solver_name << ","; // high level solver name
   to_csv << "PIBT" << ","; // low level solver name
   to_csv << -1 << ","; // disappear or not
   to_csv << -1 << ","; // 是否使用CAT break tie
   to_csv << -1 << ","; // random seed
 
-  size_t total_cost_disappear_at_goal = get_sum_of_loss(solution);
   to_csv << total_cost_disappear_at_goal << ",";
   auto plan_time = comp_time_ms / 1000; // 以秒为单位
   to_csv << plan_time << ",";
@@ -200,3 +175,191 @@ void make_log(const Instance &ins, const Solution &solution,
   to_csv << std::put_time(std::localtime(&currentTime), "%Y-%m-%d %H:%M:%S")
          << "\n";
 }
+
+
+// starts, goals and the solution in the format of the visualizer
+static void write_starts_goals(std::ostream &log, const Instance &ins)
+{
+  auto get_x = [&](int k) { return k % ins.G.width; };
+  auto get_y = [&](int k) { return k / ins.G.width; };
+  log << "starts=";
+  for (size_t i = 0; i < ins.N; ++i) {
+    auto k = ins.starts[i]->index;
+    log << "(" << get_x(k) << "," << get_y(k) << "),";
+  }
+  log << "\ngoals=";
+  for (size_t i = 0; i < ins.N; ++i) {
+    auto k = ins.goals[i]->index;
+    log << "(" << get_x(k) << "," << get_y(k) << "),";
+  }
+  log << "\nsolution=\n";
+}
+
+static void write_config(std::ostream &log, const Instance &ins, const int t,
+                         const Config &C)
+{
+  log << t << ":";
+  for (auto v : C) {
+    log << "(" << v->index % ins.G.width << "," << v->index / ins.G.width
+        << "),";
+  }
+  log << "\n";
+}
+
+static void write_paths(std::ostream &log, const Instance &ins,
+                        const Solution &solution)
+{
+  write_starts_goals(log, ins);
+  for (size_t t = 0; t < solution.size(); ++t) {
+    write_config(log, ins, t, solution[t]);
+  }
+}
+
+// 将多智能体路径规划（MAPF）实验结果写入日志文件
+void make_log(const Instance &ins, const Solution &solution,
+              const std::string &output_name, const double comp_time_ms,
+              const std::string &map_name, const std::string &scen_name, const int seed, const bool log_short,
+              const MemoryBudget *budget, const QualityCurve *curve)
+{
+  // map name
+  const auto map_recorded_name = get_map_recorded_name(map_name);
+
+  // for instance-specific values
+  auto dist_table = DistTable(ins);
+
+  // log for visualizer
+  std::ofstream log;
+  log.open(output_name, std::ios::out);
+  log << "agents=" << ins.N << "\n";
+  log << "map_file=" << map_recorded_name << "\n";
+  log << "solver=planner\n";
+  log << "solved=" << !solution.empty() << "\n";
+  log << "soc=" << get_sum_of_costs(solution) << "\n";
+  log << "soc_lb=" << get_sum_of_costs_lower_bound(ins, dist_table) << "\n";
+  log << "makespan=" << get_makespan(solution) << "\n";
+  log << "makespan_lb=" << get_makespan_lower_bound(ins, dist_table) << "\n";
+  log << "sum_of_loss=" << get_sum_of_loss(solution) << "\n";
+  log << "sum_of_loss_lb=" << get_sum_of_costs_lower_bound(ins, dist_table)
+      << "\n";
+  log << "comp_time=" << comp_time_ms << "\n";
+  log << "peak_mem_mb=" << get_peak_memory_mb() << "\n";
+  log << "seed=" << seed << "\n";
+  if (budget != nullptr) {
+    log << "memory_limit_mb=" << budget->limit / 1024.0 / 1024.0 << "\n";
+    log << "memory_accounted_mb=" << budget->peak_mb() << "\n";
+    log << "memory_status=" << budget->get_status_name() << "\n";
+  }
+  if (curve != nullptr) {
+    // elapsed ms:sum of loss
+    log << "lns_curve=";
+    for (auto &&p : *curve) log << p.first << ":" << p.second << ",";
+    log << "\n";
+  }
+  if (log_short) return;
+  write_paths(log, ins, solution);
+  log.close();
+
+  // save result to csv
+  append_csv(ins, map_recorded_name, scen_name, "Lacam",
+             get_sum_of_loss(solution), comp_time_ms);
+}
+
+// 写入临时文件后重命名，读取方总是看到完整的文件
+void make_improvement_log(const Instance &ins, const Solution &solution,
+                          const int cost, const int count,
+                          const std::string &output_name,
+                          const double comp_time_ms,
+                          const std::string &map_name, const int seed)
+{
+  const auto tmp_name = output_name + ".tmp";
+  std::ofstream log(tmp_name, std::ios::out);
+  log << "agents=" << ins.N << "\n";
+  log << "map_file=" << get_map_recorded_name(map_name) << "\n";
+  log << "solver=planner\n";
+  log << "solved=" << !solution.empty() << "\n";
+  log << "improvement=" << count << "\n";
+  log << "cost=" << cost << "\n";
+  log << "soc=" << get_sum_of_costs(solution) << "\n";
+  log << "makespan=" << get_makespan(solution) << "\n";
+  log << "sum_of_loss=" << get_sum_of_loss(solution) << "\n";
+  log << "comp_time=" << comp_time_ms << "\n";
+  log << "seed=" << seed << "\n";
+  write_paths(log, ins, solution);
+  log.close();
+  if (!log || std::rename(tmp_name.c_str(), output_name.c_str()) != 0) {
+    warn("failed to write ", output_name);
+  }
+}
+
+void make_curve_log(const Instance &ins, const QualityCurve &curve,
+                    const std::string &output_name,
+                    const std::string &map_name, const std::string &scen_name,
+                    const int seed)
+{
+  // -1 when missing
+  const auto is_new = std::ifstream(output_name, std::ios::ate).tellg() <= 0;
+  std::ofstream log(output_name, std::ios::app);
+  if (is_new) log << "map,scen,agents,seed,elapsed_ms,sum_of_loss\n";
+  const auto map_recorded_name = get_map_recorded_name(map_name);
+  for (auto &&p : curve) {
+    log << map_recorded_name << "," << scen_name << "," << ins.N << ","
+        << seed << "," << p.first << "," << p.second << "\n";
+  }
+  log.close();
+  if (!log) warn("failed to write ", output_name);
+}
+
+StreamingLog::StreamingLog(const Instance &_ins,
+                           const std::string &_output_name,
+                           const std::string &map_name, const int _seed,
+                           const bool _log_short)
+    : ins(_ins),
+      output_name(_output_name),
+      paths_name(_output_name + ".paths"),
+      map_recorded_name(get_map_recorded_name(map_name)),
+      seed(_seed),
+      log_short(_log_short),
+      paths()
+{
+  if (log_short) return;
+  paths.open(paths_name, std::ios::out);
+  write_starts_goals(paths, ins);
+}
+
+void StreamingLog::write_config(const int t, const Config &Q)
+{
+  if (log_short) return;
+  ::write_config(paths, ins, t, Q);
+}
+
+// 求解结束后按 make_log 的顺序写入统计信息与路径，并追加到 csv
+void StreamingLog::close(const RolloutStats &stats, const double comp_time_ms,
+                         const std::string &scen_name)
+{
+  std::ofstream log(output_name, std::ios::out);
+  log << "agents=" << ins.N << "\n";
+  log << "map_file=" << map_recorded_name << "\n";
+  log << "solver=pibt\n";
+  log << "solved=" << stats.solved << "\n";
+  log << "soc=" << stats.sum_of_costs << "\n";
+  log << "soc_lb=" << stats.sum_of_costs_lb << "\n";
+  log << "makespan=" << stats.makespan << "\n";
+  log << "makespan_lb=" << stats.makespan_lb << "\n";
+  log << "sum_of_loss=" << stats.sum_of_loss << "\n";
+  log << "sum_of_loss_lb=" << stats.sum_of_costs_lb << "\n";
+  log << "comp_time=" << comp_time_ms << "\n";
+  log << "peak_mem_mb=" << get_peak_memory_mb() << "\n";
+  log << "seed=" << seed << "\n";
+  if (!log_short) {
+    paths.close();
+    std::ifstream in(paths_name, std::ios::in);
+    log << in.rdbuf();
+    in.close();
+    std::remove(paths_name.c_str());
+  }
+  log.close();
+  if (!log) warn("failed to write ", output_name);
+
+  append_csv(ins, map_recorded_name, scen_name, "None", stats.sum_of_loss,
+             comp_time_ms);
+}
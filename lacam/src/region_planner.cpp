@@ -0,0 +1,359 @@
+#include "../include/region_planner.hpp"
+
+int RegionPlanner::TILE_SIZE = 64;
+int RegionPlanner::EPOCH_LENGTH = 32;
+int RegionPlanner::NUM_THREADS = 4;
+
+RegionPlanner::RegionPlanner(const Instance *_ins, int _verbose,
+                             const Deadline *_deadline, int _seed)
+    : ins(_ins),
+      deadline(_deadline),
+      seed(_seed),
+      verbose(_verbose),
+      epoch_length(std::max(1, EPOCH_LENGTH)),
+      regions(),
+      region_of(),
+      exits(),
+      region_dists(),
+      group_of(),
+      stuck(),
+      occupant(),
+      reserved(),
+      pool(NUM_THREADS)
+{
+  setup_regions();
+}
+
+RegionPlanner::~RegionPlanner() {}
+
+// 按瓦片划分图，每个瓦片内的连通分量为一个区域，并记录区域之间的边界格
+void RegionPlanner::setup_regions()
+{
+  const auto tile_size = std::max(1, TILE_SIZE);
+  auto get_tile = [&](const Vertex *v) {
+    return std::make_pair(v->x / tile_size, v->y / tile_size);
+  };
+  region_of.assign(ins->G.size(), -1);
+  for (auto v : ins->G.V) {
+    if (region_of[v->id] != -1) continue;
+    const int r = regions.size();
+    regions.emplace_back(std::vector<int>{v->id});
+    auto &&region = regions.back();
+    region_of[v->id] = r;
+    const auto tile = get_tile(v);
+    for (size_t k = 0; k < region.size(); ++k) {
+      for (auto u : ins->G.V[region[k]]->neighbors) {
+        if (region_of[u->id] != -1 || get_tile(u) != tile) continue;
+        region_of[u->id] = r;
+        region.push_back(u->id);
+      }
+    }
+    std::sort(region.begin(), region.end());
+  }
+
+  exits.resize(regions.size());
+  for (auto v : ins->G.V) {
+    for (auto u : v->neighbors) {
+      if (region_of[u->id] == region_of[v->id]) continue;
+      auto &&cells = exits[region_of[v->id]][region_of[u->id]];
+      if (cells.empty() || cells.back() != v->id) cells.push_back(v->id);
+    }
+  }
+  region_dists.resize(regions.size());
+  group_of.resize(regions.size());
+  std::iota(group_of.begin(), group_of.end(), 0);
+}
+
+// 在区域图上从目标区域做 BFS
+const std::vector<int> &RegionPlanner::get_region_dists(const int goal_region)
+{
+  auto &&dists = region_dists[goal_region];
+  if (!dists.empty()) return dists;
+  dists.assign(regions.size(), INT_MAX);
+  dists[goal_region] = 0;
+  auto OPEN = std::queue<int>({goal_region});
+  while (!OPEN.empty()) {
+    const auto r = OPEN.front();
+    OPEN.pop();
+    for (auto &&e : exits[r]) {
+      if (dists[e.first] != INT_MAX) continue;
+      dists[e.first] = dists[r] + 1;
+      OPEN.push(e.first);
+    }
+  }
+  return dists;
+}
+
+int RegionPlanner::get_next_region(const int r, const int goal_region)
+{
+  auto &&dists = get_region_dists(goal_region);
+  auto next = -1;
+  for (auto &&e : exits[r]) {
+    if (dists[e.first] == INT_MAX) continue;
+    if (next == -1 || dists[e.first] < dists[next]) next = e.first;
+  }
+  return next;
+}
+
+int RegionPlanner::find_group(const int r)
+{
+  if (group_of[r] == r) return r;
+  return group_of[r] = find_group(group_of[r]);
+}
+
+// 为组内的智能体分配互不相同的局部目标，然后运行 EPOCH_LENGTH 步 PIBT
+int RegionPlanner::plan_group(const std::vector<int> &cells,
+                              const std::vector<int> &agents, const Config &Q,
+                              const int epoch, std::vector<Config> &configs)
+{
+  const int K = ins->G.size();
+  const auto group = group_of[region_of[cells.front()]];
+  auto in_group = [&](const int v_id) {
+    return group_of[region_of[v_id]] == group;
+  };
+  auto get_local = [&](const int v_id) -> int {
+    return std::lower_bound(cells.begin(), cells.end(), v_id) - cells.begin();
+  };
+  auto taken = std::vector<char>(cells.size(), false);
+  auto start_ids = std::vector<int>();
+  auto goal_ids = std::vector<int>(agents.size(), -1);
+  for (size_t j = 0; j < agents.size(); ++j) {
+    const auto i = agents[j];
+    const auto g_id = ins->goals[i]->id;
+    start_ids.push_back(get_local(Q[i]->id));
+    if (!in_group(g_id)) continue;
+    if (g_id == Q[i]->id && reserved[g_id] != -1) continue;  // make room
+    goal_ids[j] = get_local(g_id);
+    taken[goal_ids[j]] = true;
+  }
+
+  // the others head for the border towards the first region on their route
+  // out of the group, cells whose neighbors over the border are free first
+  auto candidates = std::vector<std::pair<int, int>>();  // (key, cell)
+  for (size_t j = 0; j < agents.size(); ++j) {
+    if (goal_ids[j] != -1) continue;
+    const auto i = agents[j];
+    const auto g = ins->goals[i];
+    candidates.clear();
+    if (in_group(g->id)) {
+      // staying at the goal blocks an agent entering the group, step aside,
+      // preferably off the border
+      for (auto v_id : cells) {
+        if (reserved[v_id] != -1) continue;
+        const auto v = ins->G.V[v_id];
+        auto key = manhattanDist(v, Q[i]);
+        for (auto u : v->neighbors) {
+          if (!in_group(u->id)) key = K + manhattanDist(v, Q[i]);
+        }
+        candidates.emplace_back(key, get_local(v_id));
+      }
+    } else {
+      auto r = region_of[Q[i]->id];
+      auto next = get_next_region(r, region_of[g->id]);
+      while (group_of[next] == group) {
+        r = next;
+        next = get_next_region(r, region_of[g->id]);
+      }
+      for (auto v_id : exits[r].at(next)) {
+        const auto v = ins->G.V[v_id];
+        auto blocked = 1;
+        for (auto u : v->neighbors) {
+          if (region_of[u->id] == next && occupant[u->id] == -1) blocked = 0;
+        }
+        candidates.emplace_back(blocked * K + manhattanDist(v, g),
+                                get_local(v_id));
+      }
+      candidates.emplace_back(2 * K, start_ids[j]);  // wait
+    }
+    std::sort(candidates.begin(), candidates.end());
+    for (auto &&c : candidates) {
+      if (taken[c.second]) continue;
+      goal_ids[j] = c.second;
+      break;
+    }
+    for (size_t k = 0; goal_ids[j] == -1; ++k) {
+      if (!taken[k]) goal_ids[j] = k;
+    }
+    taken[goal_ids[j]] = true;
+  }
+
+  // PIBT on the group, regions are small -> lazy distance tables
+  const auto sub = Instance(ins->G, cells, start_ids, goal_ids);
+  auto D = DistTable(sub, nullptr, false);
+  // groups run on the pool, no nested threads
+  auto rollout = PIBTRollout(&sub, &D, 0, deadline, seed + epoch, 1);
+  rollout.max_timestep = epoch_length;
+  auto last = 0;
+  rollout.run(sub.starts, [&](int t, const Config &C) {
+    for (size_t j = 0; j < agents.size(); ++j) {
+      configs[t][agents[j]] = ins->G.V[cells[C[j]->id]];
+    }
+    last = t;
+  });
+  for (auto t = last + 1; t <= epoch_length; ++t) {
+    for (auto i : agents) configs[t][i] = configs[last][i];
+  }
+  return last;
+}
+
+// 边界上的智能体按编号顺序移动到下一区域中未被占用、未被预约的格子
+int RegionPlanner::hand_off(Config &Q)
+{
+  std::fill(occupant.begin(), occupant.end(), -1);
+  for (size_t i = 0; i < ins->N; ++i) occupant[Q[i]->id] = i;
+  auto moved = 0;
+  for (size_t i = 0; i < ins->N; ++i) {
+    const auto r = region_of[Q[i]->id];
+    const auto goal_region = region_of[ins->goals[i]->id];
+    if (r == goal_region) continue;
+    const auto next = get_next_region(r, goal_region);
+    auto blocked = false;
+    for (auto u : Q[i]->neighbors) {
+      if (region_of[u->id] != next) continue;
+      if (occupant[u->id] != -1) {
+        blocked = true;
+        continue;
+      }
+      occupant[u->id] = i;  // reservation, the old cell is kept occupied
+      Q[i] = u;
+      ++moved;
+      blocked = false;
+      break;
+    }
+    if (blocked) stuck.emplace_back(r, next);
+  }
+  return moved;
+}
+
+Solution RegionPlanner::solve()
+{
+  const int N = ins->N;
+  info(1, verbose, deadline, "region planner, regions: ", regions.size(),
+       ", tile size: ", TILE_SIZE);
+  auto solution = Solution({ins->starts});
+  auto agents_of = std::vector<std::vector<int>>(regions.size());
+  auto cells_of = std::vector<std::vector<int>>(regions.size());
+  auto active = std::vector<int>();  // groups with agents
+  auto lengths = std::vector<int>();
+  auto configs = std::vector<Config>(epoch_length + 1, Config(N, nullptr));
+  occupant.assign(ins->G.size(), -1);
+  reserved.assign(ins->G.size(), -1);
+  // epochs without progress until regions are merged
+  const auto max_stalls = 4;
+  auto best_remaining = INT_MAX;
+  auto stalls = 0;
+
+  for (auto epoch = 0;; ++epoch) {
+    auto Q = solution.back();
+    if (is_same_config(Q, ins->goals)) break;
+    if (is_expired(deadline)) {
+      info(1, verbose, deadline, "region planner, reach time limit");
+      return Solution();
+    }
+
+    // merge regions where agents got stuck, split them when nobody is
+    if (stuck.empty()) std::iota(group_of.begin(), group_of.end(), 0);
+    for (auto &&e : stuck) {
+      const auto a = find_group(e.first);
+      const auto b = find_group(e.second);
+      group_of[std::max(a, b)] = std::min(a, b);
+    }
+    stuck.clear();
+    for (size_t r = 0; r < regions.size(); ++r) find_group(r);
+
+    // group agents, routes are computed here, not on the pool
+    for (auto g : active) {
+      agents_of[g].clear();
+      cells_of[g].clear();
+    }
+    active.clear();
+    std::fill(occupant.begin(), occupant.end(), -1);
+    std::fill(reserved.begin(), reserved.end(), -1);
+    for (auto i = 0; i < N; ++i) {
+      const auto r = region_of[Q[i]->id];
+      const auto goal_region = region_of[ins->goals[i]->id];
+      if (get_region_dists(goal_region)[r] == INT_MAX) {
+        info(1, verbose, deadline, "region planner, unreachable goal");
+        return Solution();
+      }
+      if (agents_of[group_of[r]].empty()) active.push_back(group_of[r]);
+      agents_of[group_of[r]].push_back(i);
+      occupant[Q[i]->id] = i;
+    }
+    // agents at a border reserve the cell over it, the first one wins
+    for (auto i = 0; i < N; ++i) {
+      const auto r = region_of[Q[i]->id];
+      const auto goal_region = region_of[ins->goals[i]->id];
+      if (r == goal_region) continue;
+      const auto next = get_next_region(r, goal_region);
+      for (auto u : Q[i]->neighbors) {
+        if (region_of[u->id] != next || reserved[u->id] != -1) continue;
+        reserved[u->id] = i;
+        break;
+      }
+    }
+    for (size_t r = 0; r < regions.size(); ++r) {
+      const auto g = group_of[r];
+      if (agents_of[g].empty()) continue;
+      cells_of[g].insert(cells_of[g].end(), regions[r].begin(),
+                         regions[r].end());
+    }
+    for (auto g : active) {
+      if (cells_of[g].size() == regions[g].size()) continue;
+      std::sort(cells_of[g].begin(), cells_of[g].end());
+    }
+
+    // plan groups in parallel, each writes the columns of its agents
+    lengths.assign(active.size(), 0);
+    configs[0] = Q;
+    pool.run(active.size(), [&](int k, int) {
+      lengths[k] = plan_group(cells_of[active[k]], agents_of[active[k]], Q,
+                              epoch, configs);
+    });
+    const auto T = *std::max_element(lengths.begin(), lengths.end());
+    for (auto t = 1; t <= T; ++t) solution.push_back(configs[t]);
+
+    // hand-off at borders
+    auto Q_next = configs[T];
+    const auto moved = hand_off(Q_next);
+    if (moved > 0) solution.push_back(Q_next);
+    info(2, verbose, deadline, "epoch ", epoch, ", steps: ", T,
+         ", hand-offs: ", moved, ", groups: ", active.size());
+
+    // progress: remaining hops over regions and agents away from goals
+    auto remaining = 0;
+    for (auto i = 0; i < N; ++i) {
+      const auto goal_region = region_of[ins->goals[i]->id];
+      remaining += get_region_dists(goal_region)[region_of[Q_next[i]->id]];
+      if (Q_next[i] != ins->goals[i]) ++remaining;
+    }
+    if (remaining < best_remaining) {
+      best_remaining = remaining;
+      stalls = 0;
+    } else {
+      ++stalls;
+    }
+    const auto no_change = moved == 0 && is_same_config(Q_next, Q);
+    if (!no_change && stalls < max_stalls) continue;
+
+    // no progress, plan agents together with their next regions
+    auto escalated = false;
+    for (auto i = 0; i < N; ++i) {
+      const auto r = region_of[Q_next[i]->id];
+      const auto goal_region = region_of[ins->goals[i]->id];
+      if (r == goal_region) continue;
+      const auto next = get_next_region(r, goal_region);
+      if (find_group(r) == find_group(next)) continue;
+      stuck.emplace_back(r, next);
+      escalated = true;
+    }
+    stalls = 0;
+    if (no_change && !escalated) {
+      info(1, verbose, deadline, "region planner, no progress");
+      return Solution();
+    }
+  }
+  info(1, verbose, deadline, "region planner, makespan: ",
+       solution.size() - 1);
+  return solution;
+}
@@ -0,0 +1,94 @@
+#include "../include/spill.hpp"
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+#include <cstring>
+
+size_t SpillFile::INITIAL_CAPACITY = 64 << 20;
+
+SpillFile::SpillFile(const Graph *_G, const size_t _N, const std::string &dir)
+    : G(_G),
+      N(_N),
+      record_size(sizeof(uint64_t) + sizeof(uint32_t) * N),
+      fd(-1),
+      data(nullptr),
+      size(0),
+      capacity(0),
+      failed(false)
+{
+  auto path = dir + "/lacam-spill-XXXXXX";
+  fd = mkstemp(path.data());
+  if (fd < 0) return;
+  unlink(path.c_str());  // removed when closed
+  capacity = std::max(INITIAL_CAPACITY, record_size);
+  // blocks are reserved, writes to a sparse mapping raise SIGBUS on a full disk
+  if (posix_fallocate(fd, 0, capacity) != 0) {
+    close(fd);
+    fd = -1;
+    return;
+  }
+  auto p = mmap(nullptr, capacity, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+  if (p == MAP_FAILED) {
+    close(fd);
+    fd = -1;
+    return;
+  }
+  data = static_cast<char *>(p);
+}
+
+SpillFile::~SpillFile()
+{
+  if (data != nullptr) munmap(data, capacity);
+  if (fd >= 0) close(fd);
+}
+
+bool SpillFile::is_open() const { return data != nullptr; }
+
+// 追加一条记录；容量不足时扩大文件并重新映射，之前的指针随之失效
+bool SpillFile::append(const uint64_t hash, const Config &C, uint64_t &offset)
+{
+  if (failed) return false;
+  if (size + record_size > capacity) {
+    const auto new_capacity = capacity * 2;
+    if (posix_fallocate(fd, capacity, new_capacity - capacity) != 0) {
+      failed = true;
+      return false;
+    }
+    // the old mapping stays valid until the new one is in place
+    auto p = mmap(nullptr, new_capacity, PROT_READ | PROT_WRITE, MAP_SHARED,
+                  fd, 0);
+    if (p == MAP_FAILED) {
+      failed = true;
+      return false;
+    }
+    munmap(data, capacity);
+    data = static_cast<char *>(p);
+    capacity = new_capacity;
+  }
+  offset = size;
+  auto ptr = data + offset;
+  std::memcpy(ptr, &hash, sizeof(uint64_t));
+  auto ids = reinterpret_cast<uint32_t *>(ptr + sizeof(uint64_t));
+  for (size_t i = 0; i < N; ++i) ids[i] = C[i]->id;
+  size += record_size;
+  return true;
+}
+
+uint64_t SpillFile::get_hash(const uint64_t offset) const
+{
+  auto hash = uint64_t(0);
+  std::memcpy(&hash, data + offset, sizeof(uint64_t));
+  return hash;
+}
+
+void SpillFile::read(const uint64_t offset, Config &C) const
+{
+  auto ids = reinterpret_cast<const uint32_t *>(data + offset +
+                                                sizeof(uint64_t));
+  C.resize(N);
+  for (size_t i = 0; i < N; ++i) C[i] = G->V[ids[i]];
+}
+
+size_t SpillFile::num_records() const { return size / record_size; }
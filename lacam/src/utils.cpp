@@ -1,9 +1,24 @@
 #include "../include/utils.hpp"
 
+#if defined(__unix__) || defined(__APPLE__)
+#include <sys/resource.h>
+#endif
+
 void info(const int level, const int verbose) { std::cout << std::endl; }
 
-Deadline::Deadline(double _time_limit_ms)
-    : t_s(Time::now()), time_limit_ms(_time_limit_ms)
+CancelToken::CancelToken() : cancelled(false) {}
+
+void CancelToken::cancel() { cancelled.store(true, std::memory_order_relaxed); }
+
+void CancelToken::reset() { cancelled.store(false); }
+
+bool CancelToken::is_cancelled() const
+{
+  return cancelled.load(std::memory_order_relaxed);
+}
+
+Deadline::Deadline(double _time_limit_ms, const CancelToken *_token)
+    : t_s(Time::now()), time_limit_ms(_time_limit_ms), token(_token)
 {
 }
 
@@ -20,6 +35,11 @@ double Deadline::elapsed_ns() const
       .count();
 }
 
+bool Deadline::is_cancelled() const
+{
+  return token != nullptr && token->is_cancelled();
+}
+
 double elapsed_ms(const Deadline *deadline)
 {
   if (deadline == nullptr) return 0;
@@ -35,11 +55,116 @@ double elapsed_ns(const Deadline *deadline)
 bool is_expired(const Deadline *deadline)
 {
   if (deadline == nullptr) return false;
-  return deadline->elapsed_ms() > deadline->time_limit_ms;
+  if (deadline->is_cancelled()) return true;
+  return deadline->elapsed_ns() > deadline->time_limit_ms * 1e6;
 }
 
 bool is_expired(const Deadline &deadline) { return is_expired(&deadline); }
 
+bool is_cancelled(const Deadline *deadline)
+{
+  return deadline != nullptr && deadline->is_cancelled();
+}
+
+double DeadlineChecker::CHECK_PERIOD_US = 50;
+
+DeadlineChecker::DeadlineChecker(const Deadline *_deadline)
+    : deadline(_deadline), t_last(Time::now()), interval(1), count(0)
+{
+}
+
+// 间隔内只检查取消标志；读取时钟时根据距上次读取的时间调整间隔
+bool DeadlineChecker::is_expired()
+{
+  if (deadline == nullptr) return false;
+  if (deadline->is_cancelled()) return true;
+  if (++count < interval) return false;
+  count = 0;
+  const auto t_now = Time::now();
+  const auto gap_us =
+      std::chrono::duration<double, std::micro>(t_now - t_last).count();
+  t_last = t_now;
+  if (gap_us < CHECK_PERIOD_US / 2) {
+    interval = std::min(interval * 2, MAX_INTERVAL);
+  } else if (gap_us > CHECK_PERIOD_US * 2) {
+    interval = std::max(interval / 2, 1);
+  }
+  return std::chrono::duration<double, std::milli>(t_now - deadline->t_s)
+             .count() > deadline->time_limit_ms;
+}
+
+float MemoryBudget::DROP_EXPLORED_RATIO = 0.8;
+float MemoryBudget::ROLLOUT_RATIO = 0.9;
+
+MemoryBudget::MemoryBudget(double _limit_mb)
+    : limit(_limit_mb * 1024 * 1024), used(0), peak(0), status(OK)
+{
+}
+
+void MemoryBudget::allocate(size_t bytes)
+{
+  const auto now = used.fetch_add(bytes) + bytes;
+  auto prev = peak.load();
+  while (prev < now && !peak.compare_exchange_weak(prev, now)) {
+  }
+}
+
+void MemoryBudget::deallocate(size_t bytes) { used.fetch_sub(bytes); }
+
+size_t MemoryBudget::get_remaining() const
+{
+  if (limit == 0) return SIZE_MAX;
+  const size_t u = used;
+  return u >= limit ? 0 : limit - u;
+}
+
+float MemoryBudget::get_usage() const
+{
+  if (limit == 0) return 0;
+  return (float)used / limit;
+}
+
+double MemoryBudget::used_mb() const { return used / 1024.0 / 1024.0; }
+
+double MemoryBudget::peak_mb() const { return peak / 1024.0 / 1024.0; }
+
+void MemoryBudget::degrade(const Status s)
+{
+  auto prev = status.load();
+  while (prev < s && !status.compare_exchange_weak(prev, s)) {
+  }
+}
+
+const char *MemoryBudget::get_status_name() const
+{
+  switch (status) {
+    case DROP_EXPLORED:
+      return "drop_explored";
+    case ROLLOUT:
+      return "rollout";
+    case STOPPED:
+      return "stopped";
+    default:
+      return "ok";
+  }
+}
+
+float get_memory_usage(const MemoryBudget *budget)
+{
+  if (budget == nullptr) return 0;
+  return budget->get_usage();
+}
+
+bool is_exceeded(const MemoryBudget *budget)
+{
+  return get_memory_usage(budget) >= 1;
+}
+
+bool is_out_of_memory(const MemoryBudget *budget)
+{
+  return budget != nullptr && budget->status == MemoryBudget::STOPPED;
+}
+
 float get_random_float(std::mt19937 &MT, float from, float to)
 {
   return std::uniform_real_distribution<float>(from, to)(MT);
@@ -60,6 +185,92 @@ int get_random_int(std::mt19937 *MT, int from, int to)
   return get_random_int(*MT, from, to);
 }
 
+uint64_t splitmix64(uint64_t &x)
+{
+  auto z = (x += 0x9e3779b97f4a7c15ULL);
+  z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+  z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+  return z ^ (z >> 31);
+}
+
+Xoshiro256pp::Xoshiro256pp(uint64_t seed)
+{
+  for (auto &&x : s) x = splitmix64(seed);
+}
+
+ThreadPool::ThreadPool(int _num_threads)
+    : num_threads(std::max(1, _num_threads)),
+      workers(),
+      job(nullptr),
+      job_size(0),
+      next_task(0),
+      num_busy(0),
+      generation(0),
+      stop(false)
+{
+  for (auto w = 1; w < num_threads; ++w) {
+    workers.emplace_back([this, w]() { loop(w); });
+  }
+}
+
+ThreadPool::~ThreadPool()
+{
+  {
+    std::lock_guard<std::mutex> lock(mtx);
+    stop = true;
+  }
+  cv_start.notify_all();
+  for (auto &th : workers) th.join();
+}
+
+void ThreadPool::run(const int n, const std::function<void(int, int)> &f)
+{
+  if (n <= 0) return;
+  if (num_threads == 1 || n == 1) {
+    for (auto k = 0; k < n; ++k) f(k, 0);
+    return;
+  }
+  {
+    std::lock_guard<std::mutex> lock(mtx);
+    job = &f;
+    job_size = n;
+    next_task = 0;
+    num_busy = num_threads - 1;
+    ++generation;
+  }
+  cv_start.notify_all();
+  work(0);
+  std::unique_lock<std::mutex> lock(mtx);
+  cv_done.wait(lock, [&]() { return num_busy == 0; });
+  job = nullptr;
+}
+
+void ThreadPool::work(const int worker_id)
+{
+  for (auto k = next_task.fetch_add(1); k < job_size;
+       k = next_task.fetch_add(1)) {
+    (*job)(k, worker_id);
+  }
+}
+
+void ThreadPool::loop(const int worker_id)
+{
+  uint seen = 0;
+  while (true) {
+    {
+      std::unique_lock<std::mutex> lock(mtx);
+      cv_start.wait(lock, [&]() { return stop || generation != seen; });
+      if (stop) return;
+      seen = generation;
+    }
+    work(worker_id);
+    {
+      std::lock_guard<std::mutex> lock(mtx);
+      if (--num_busy == 0) cv_done.notify_all();
+    }
+  }
+}
+
 std::ostream &operator<<(std::ostream &os, const std::vector<int> &arr)
 {
   for (auto ele : arr) os << ele << ",";
@@ -71,3 +282,18 @@ std::ostream &operator<<(std::ostream &os, const std::set<int> &arr)
   for (auto ele : arr) os << ele << ",";
   return os;
 }
+
+double get_peak_memory_mb()
+{
+#if defined(__unix__) || defined(__APPLE__)
+  struct rusage usage;
+  if (getrusage(RUSAGE_SELF, &usage) != 0) return 0;
+#ifdef __APPLE__
+  return (double)usage.ru_maxrss / (1024 * 1024);  // bytes
+#else
+  return (double)usage.ru_maxrss / 1024;  // kilobytes
+#endif
+#else
+  return 0;
+#endif
+}
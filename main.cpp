@@ -1,6 +1,16 @@
 #include <argparse/argparse.hpp>
+#include <csignal>
 #include <planner.hpp>
 
+// set by SIGINT, the solver stops and the best solution so far is written
+static CancelToken cancel_token;
+
+static void on_interrupt(int)
+{
+  cancel_token.cancel();
+  std::signal(SIGINT, SIG_DFL);  // a second SIGINT terminates immediately
+}
+
 int main(int argc, char *argv[])
 {
   // arguments parser
@@ -31,10 +41,46 @@ int main(int argc, char *argv[])
       .implicit_value(true);
 
   // solver parameters
+  program.add_argument("--solver")
+      .help("lacam, pibt for massive agents (no search, streaming output), "
+            "or regions for huge maps (PIBT per region of the tiled map)")
+      .default_value("lacam");
   program.add_argument("--anytime")
       .help("use anytime refinement by tree rewiring")
       .default_value(false)
       .implicit_value(true);
+  program.add_argument("--background_refinement")
+      .help("report the first solution immediately and refine it in a "
+            "background thread until the time limit, implies --anytime")
+      .default_value(false)
+      .implicit_value(true);
+  program.add_argument("--full_config_interval")
+      .help("1: store full configurations, k: store moves of agents and a "
+            "full configuration every k levels, less memory for large N")
+      .scan<'d', int>()
+      .default_value(1);
+  program.add_argument("--spill_dir")
+      .help("directory for configurations of exhausted nodes, e.g., on a "
+            "local SSD; empty: keep all in memory, single-thread only")
+      .default_value(std::string(""));
+  program.add_argument("--checkpoint")
+      .help("file to save the search state periodically and at the end")
+      .default_value(std::string(""));
+  program.add_argument("--checkpoint_interval_sec")
+      .scan<'g', float>()
+      .default_value(float(60));
+  program.add_argument("--resume")
+      .help("checkpoint to continue the search from, e.g., in anytime mode")
+      .default_value(std::string(""));
+  program.add_argument("--improvement_file")
+      .help("file replaced with each new best solution while searching, "
+            "e.g., in anytime mode")
+      .default_value(std::string(""));
+  program.add_argument("--memory_limit_mb")
+      .help("0: unlimited, otherwise the search degrades near the limit: "
+            "drop explored nodes, complete by PIBT, then stop")
+      .scan<'g', float>()
+      .default_value(float(0));
   program.add_argument("--no_dist_table_init")
       .help("disable to pre-compute distance tables with multi-threading")
       .default_value(false)
@@ -47,6 +93,78 @@ int main(int argc, char *argv[])
       .help("turn off the hindrance heuristic")
       .default_value(false)
       .implicit_value(true);
+  program.add_argument("--pibt_cluster")
+      .help("partition agents into independent clusters in each PIBT call")
+      .default_value(false)
+      .implicit_value(true);
+  program.add_argument("--pibt_threads")
+      .help("number of threads for PIBT clusters, implies --pibt_cluster")
+      .scan<'d', int>()
+      .default_value(1);
+  program.add_argument("--threads")
+      .help("number of threads for the high-level search")
+      .scan<'d', int>()
+      .default_value(1);
+  program.add_argument("--batch_expansion")
+      .help("number of constraints of one node evaluated by PIBT in "
+            "parallel, 1: sequential")
+      .scan<'d', int>()
+      .default_value(1);
+  program.add_argument("--decompose")
+      .help("solve groups of agents with distant shortest paths separately, "
+            "joint search if their plans collide")
+      .default_value(false)
+      .implicit_value(true);
+  program.add_argument("--decompose_threads")
+      .help("number of groups solved concurrently")
+      .scan<'d', int>()
+      .default_value(4);
+  program.add_argument("--tile_size")
+      .help("side of square regions of --solver regions")
+      .scan<'d', int>()
+      .default_value(64);
+  program.add_argument("--epoch_length")
+      .help("PIBT steps between hand-offs of agents at region borders")
+      .scan<'d', int>()
+      .default_value(32);
+  program.add_argument("--region_threads")
+      .help("number of regions planned concurrently")
+      .scan<'d', int>()
+      .default_value(4);
+  program.add_argument("--portfolio")
+      .help("number of solver processes sharing the distance table, "
+            "0: single process")
+      .scan<'d', int>()
+      .default_value(0);
+  program.add_argument("--portfolio_target")
+      .help("stop all processes at sum_of_loss <= ratio * lower bound, "
+            "0: off")
+      .scan<'g', float>()
+      .default_value(0.0f);
+  program.add_argument("--pin_cpus")
+      .help("pin each process of the portfolio to one CPU")
+      .default_value(false)
+      .implicit_value(true);
+  program.add_argument("--lns")
+      .help("improve the solution by large neighborhood search until the "
+            "time limit, use without --anytime")
+      .default_value(false)
+      .implicit_value(true);
+  program.add_argument("--lns_threads")
+      .help("number of neighborhoods repaired concurrently")
+      .scan<'d', int>()
+      .default_value(4);
+  program.add_argument("--lns_neighbor_size")
+      .help("number of agents replanned together")
+      .scan<'d', int>()
+      .default_value(8);
+  program.add_argument("--lns_curve_file")
+      .help("csv file the quality-over-time curve of LNS is appended to")
+      .default_value(std::string(""));
+  program.add_argument("--deterministic")
+      .help("reproducible parallel search with synchronous rounds")
+      .default_value(false)
+      .implicit_value(true);
 
   try {
     program.parse_args(argc, argv);
@@ -65,6 +183,12 @@ int main(int argc, char *argv[])
   const auto output_name = program.get<std::string>("output");
   const auto log_short = program.get<bool>("log_short");
   const auto N = program.get<int>("num");
+  const auto solver_name = program.get<std::string>("solver");
+  if (solver_name != "lacam" && solver_name != "pibt" &&
+      solver_name != "regions") {
+    std::cerr << "unknown solver: " << solver_name << std::endl;
+    return 1;
+  }
   const auto ins = scen_name.size() > 0 ? Instance(scen_name, map_name, N)
                                         : Instance(map_name, N, seed);
   if (!ins.is_valid(1)) return 1;
@@ -72,14 +196,91 @@ int main(int argc, char *argv[])
   // set hyper parameters
   DistTable::MULTI_THREAD_INIT = !program.get<bool>("no_dist_table_init");
   LaCAM::ANYTIME = program.get<bool>("anytime");
+  HNode::FULL_CONFIG_INTERVAL = program.get<int>("full_config_interval");
+  LaCAM::SPILL_DIR = program.get<std::string>("spill_dir");
+  LaCAM::CHECKPOINT_FILE = program.get<std::string>("checkpoint");
+  LaCAM::CHECKPOINT_INTERVAL_MS =
+      program.get<float>("checkpoint_interval_sec") * 1000;
+  LaCAM::RESUME_FILE = program.get<std::string>("resume");
+  ParallelLaCAM::NUM_THREADS = program.get<int>("threads");
+  ParallelLaCAM::DETERMINISTIC = program.get<bool>("deterministic");
+  LaCAM::BATCH_SIZE = program.get<int>("batch_expansion");
+  Decomposition::ENABLED = program.get<bool>("decompose");
+  Decomposition::NUM_THREADS = program.get<int>("decompose_threads");
+  RegionPlanner::TILE_SIZE = program.get<int>("tile_size");
+  RegionPlanner::EPOCH_LENGTH = program.get<int>("epoch_length");
+  RegionPlanner::NUM_THREADS = program.get<int>("region_threads");
+  Portfolio::NUM_PROCESSES = program.get<int>("portfolio");
+  Portfolio::TARGET_RATIO = program.get<float>("portfolio_target");
+  Portfolio::PIN_CPUS = program.get<bool>("pin_cpus");
+  LNS::ENABLED = program.get<bool>("lns");
+  LNS::NUM_THREADS = program.get<int>("lns_threads");
+  LNS::NEIGHBOR_SIZE = program.get<int>("lns_neighbor_size");
 
   // pibt
   PIBT::SWAP = !program.get<bool>("no_pibt_swap");
   PIBT::HINDRANCE = !program.get<bool>("no_pibt_hindrance");
+  PIBT::NUM_THREADS = program.get<int>("pibt_threads");
+  PIBT::CLUSTER = program.get<bool>("pibt_cluster") || PIBT::NUM_THREADS > 1;
 
   // solve
-  const auto deadline = Deadline(time_limit_sec * 1000);
-  const auto solution = solve(ins, verbose - 1, &deadline, seed);
+  const auto deadline = Deadline(time_limit_sec * 1000, &cancel_token);
+  std::signal(SIGINT, on_interrupt);
+  auto budget = MemoryBudget(program.get<float>("memory_limit_mb"));
+
+  // standalone PIBT, configurations are streamed to the log
+  if (solver_name == "pibt") {
+    auto log = StreamingLog(ins, output_name, map_name, seed, log_short);
+    const auto stats = solve_pibt(
+        ins, [&](int t, const Config &Q) { log.write_config(t, Q); },
+        verbose - 1, &deadline, seed);
+    const auto comp_time_ms = deadline.elapsed_ms();
+    if (!stats.solved) info(1, verbose, &deadline, "failed to solve");
+    print_stats(verbose, &deadline, stats, comp_time_ms);
+    log.close(stats, comp_time_ms, scen_name);
+    return 0;
+  }
+
+  // write each improvement as it happens
+  const auto improvement_file = program.get<std::string>("improvement_file");
+  auto num_improvements = 0;
+  auto on_improve = ImproveCallback();
+  if (!improvement_file.empty()) {
+    on_improve = [&](const Solution &solution, const int cost) {
+      make_improvement_log(ins, solution, cost, ++num_improvements,
+                           improvement_file, deadline.elapsed_ms(), map_name,
+                           seed);
+    };
+  }
+
+  auto solution = Solution();
+  auto D = std::unique_ptr<DistTable>();  // shared by solve and LNS
+  if (solver_name == "regions") {
+    solution = solve_regions(ins, verbose - 1, &deadline, seed);
+  } else if (Portfolio::NUM_PROCESSES > 0) {
+    if (program.get<bool>("background_refinement")) {
+      warn("--background_refinement is ignored with --portfolio");
+    }
+    solution = solve_portfolio(ins, verbose - 1, &deadline, seed, &budget,
+                               on_improve);
+  } else if (program.get<bool>("background_refinement")) {
+    auto refinement = BackgroundRefinement(ins, verbose - 1, &deadline, seed,
+                                           &budget, on_improve);
+    solution = refinement.start();
+    info(1, verbose, &deadline, "first solution, sum_of_loss: ",
+         get_sum_of_loss(solution), ", refining in background");
+    refinement.join();
+    if (refinement.handle.get_cost() >= 0) refinement.handle.get(solution);
+  } else {
+    if (LNS::ENABLED) D = std::make_unique<DistTable>(ins, &deadline, true);
+    solution = solve(ins, verbose - 1, &deadline, seed, &budget, on_improve,
+                     D.get());
+  }
+  auto curve = QualityCurve();
+  if (LNS::ENABLED && !solution.empty()) {
+    solution = optimize_lns(ins, solution, verbose - 1, &deadline, seed,
+                            &curve, on_improve, D.get());
+  }
   const auto comp_time_ms = deadline.elapsed_ms();
 
   // failure
@@ -95,7 +296,12 @@ int main(int argc, char *argv[])
 
   // post processing
   print_stats(verbose, &deadline, ins, solution, comp_time_ms);
-  make_log(ins, solution, output_name, comp_time_ms, map_name, scen_name, seed, log_short);
+  make_log(ins, solution, output_name, comp_time_ms, map_name, scen_name, seed,
+           log_short, &budget, LNS::ENABLED ? &curve : nullptr);
+  const auto curve_file = program.get<std::string>("lns_curve_file");
+  if (LNS::ENABLED && !curve_file.empty()) {
+    make_curve_log(ins, curve, curve_file, map_name, scen_name, seed);
+  }
 
   return 0;
 }
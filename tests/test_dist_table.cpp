@@ -13,5 +13,20 @@ int main()
     assert(dist_table.get(0, ins.starts[0]) == 16);
   }
 
+  {
+    // BFS interrupted by the deadline is continued lazily
+    const auto scen_filename = "../assets/random-32-32-10-random-1.scen";
+    const auto map_filename = "../assets/random-32-32-10.map";
+    const auto ins = Instance(scen_filename, map_filename, 100);
+    auto token = CancelToken();
+    token.cancel();
+    const auto deadline = Deadline(1000, &token);
+    auto partial = DistTable(ins, &deadline);
+    auto full = DistTable(ins);
+    for (size_t i = 0; i < ins.N; ++i) {
+      for (auto v : ins.G.V) assert(partial.get(i, v) == full.get(i, v));
+    }
+  }
+
   return 0;
 }
@@ -0,0 +1,84 @@
+#include <cassert>
+#include <planner.hpp>
+
+int main()
+{
+  {
+    // cluster mode, parallel results are identical to serial ones
+    const auto map_filename = "../assets/random-32-32-10.map";
+    PIBT::CLUSTER = true;
+    for (auto N : {50, 400}) {
+      const auto ins = Instance(map_filename, N, 0);
+      auto D = DistTable(ins);
+      auto pibt_serial = PIBT(&ins, &D, 0, 1);
+      auto pibt_parallel = PIBT(&ins, &D, 0, 4);
+      assert(pibt_parallel.pool != nullptr);
+
+      auto order = std::vector<int>(N);
+      std::iota(order.begin(), order.end(), 0);
+      auto Q = ins.starts;
+      for (auto t = 0; t < 30; ++t) {
+        auto Q1 = Config(N, nullptr);
+        auto Q2 = Config(N, nullptr);
+        // constrain one agent every other step
+        if (t % 2 == 0) {
+          Q1[t % N] = Q[t % N]->actions[t % Q[t % N]->actions.size()];
+          Q2[t % N] = Q1[t % N];
+        }
+        const auto res1 = pibt_serial.set_new_config(Q, Q1, order);
+        const auto res2 = pibt_parallel.set_new_config(Q, Q2, order);
+        assert(res1 == res2);
+        if (!res1) continue;
+        assert(Q1 == Q2);
+        Q = Q1;
+        std::rotate(order.begin(), order.begin() + 1, order.end());
+      }
+    }
+    PIBT::CLUSTER = false;
+  }
+
+  {
+    // skipping settled agents does not change the result,
+    // counter-based tie-breaking makes both comparable
+    const auto map_filename = "../assets/random-32-32-10.map";
+    PIBT::CLUSTER = true;
+    const auto N = 300;
+    const auto ins = Instance(map_filename, N, 1);
+    auto D = DistTable(ins);
+    auto pibt_all = PIBT(&ins, &D, 0, 1);
+    auto pibt_active = PIBT(&ins, &D, 0, 1);
+    const auto no_constraints = std::vector<int>();
+
+    auto Q = ins.starts;
+    auto max_settled = 0;
+    for (auto t = 0; t < 60; ++t) {
+      auto order = std::vector<int>();
+      for (auto i = 0; i < N; ++i) {
+        if (Q[i] != ins.goals[i]) order.push_back(i);
+      }
+      const int num_active = order.size();
+      for (auto i = 0; i < N; ++i) {
+        if (Q[i] == ins.goals[i]) order.push_back(i);
+      }
+      max_settled = std::max(max_settled, N - num_active);
+
+      auto Q1 = Config(N, nullptr);
+      auto Q2 = Config(N, nullptr);
+      assert(pibt_all.set_new_config(Q, Q1, order));
+      assert(pibt_active.set_new_config(Q, Q2, order, no_constraints,
+                                        num_active));
+      assert(Q1 == Q2);
+      for (auto i = 0; i < N; ++i) {
+        const auto left = Q[i] == ins.goals[i] && Q2[i] != Q[i];
+        assert(left == (std::find(pibt_active.activated.begin(),
+                                  pibt_active.activated.end(),
+                                  i) != pibt_active.activated.end()));
+      }
+      Q = Q1;
+    }
+    assert(max_settled > 0);
+    PIBT::CLUSTER = false;
+  }
+
+  return 0;
+}
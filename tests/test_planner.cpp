@@ -1,4 +1,9 @@
+#include <sys/wait.h>
+#include <unistd.h>
+
 #include <cassert>
+#include <cstring>
+#include <filesystem>
 #include <planner.hpp>
 
 int main()
@@ -20,5 +25,673 @@ int main()
     assert(solution.empty());
   }
 
+  {
+    // concurrent solves sharing one instance
+    const auto scen_filename = "../assets/random-32-32-10-random-1.scen";
+    const auto map_filename = "../assets/random-32-32-10.map";
+    const auto ins = Instance(scen_filename, map_filename, 100);
+    const auto actions = ins.G.V[0]->actions;
+    auto solve_with_seed = [&](int seed) {
+      return solve(ins, 0, nullptr, seed);
+    };
+    auto solution1 = solve_with_seed(1);
+    auto solution2 = solve_with_seed(2);
+    auto f1 = std::async(std::launch::async, solve_with_seed, 1);
+    auto f2 = std::async(std::launch::async, solve_with_seed, 2);
+    assert(f1.get() == solution1);
+    assert(f2.get() == solution2);
+    assert(ins.G.V[0]->actions == actions);
+  }
+
+  {
+    const auto scen_filename = "../assets/random-32-32-10-random-1.scen";
+    const auto map_filename = "../assets/random-32-32-10.map";
+    const auto ins = Instance(scen_filename, map_filename, 50);
+    ParallelLaCAM::NUM_THREADS = 4;
+
+    // work stealing
+    const auto deadline = Deadline(1000);
+    auto solution = solve(ins, 0, &deadline);
+    assert(!solution.empty());
+    assert(is_feasible_solution(ins, solution));
+
+    // deterministic, without a deadline that could cut either run short
+    ParallelLaCAM::DETERMINISTIC = true;
+    auto solution1 = solve(ins, 0, nullptr);
+    auto solution2 = solve(ins, 0, nullptr);
+    assert(!solution1.empty());
+    assert(is_feasible_solution(ins, solution1));
+    assert(solution1 == solution2);
+
+    ParallelLaCAM::NUM_THREADS = 1;
+    ParallelLaCAM::DETERMINISTIC = false;
+  }
+
+  {
+    // merged orders of HNode agree with sorting all agents
+    const auto map_filename = "../assets/random-32-32-10.map";
+    const auto ins = Instance(map_filename, 300, 0);
+    auto D = DistTable(ins);
+    auto pibt = PIBT(&ins, &D, 0);
+    auto nodes = std::vector<HNode *>{new HNode(ins.starts, &D)};
+    for (auto t = 0; t < 60; ++t) {
+      auto H = nodes.back();
+      auto Q = Config(ins.N, nullptr);
+      assert(pibt.set_new_config(H->Q, Q, H->expansion->order, {},
+                                 H->expansion->num_active));
+      auto H_new = new HNode(Q, &D, H, 0, 0, &pibt.activated);
+      auto H_scan = new HNode(Q, &D, H, 0, 0);
+      assert(H_new->expansion->order == H_scan->expansion->order);
+      delete H_scan;
+
+      auto order = std::vector<int>(ins.N);
+      std::iota(order.begin(), order.end(), 0);
+      std::sort(order.begin(), order.end(), [&](int i, int j) {
+        return has_higher_priority(H_new->expansion->priorities, i, j);
+      });
+      H_new->complete_order();
+      assert(H_new->expansion->order == order);
+      for (auto k = 0; k < H_new->expansion->num_active; ++k) {
+        assert(Q[order[k]] != ins.goals[order[k]]);
+      }
+      nodes.push_back(H_new);
+    }
+    for (auto H : nodes) delete H;
+  }
+
+  {
+    // delta-encoded configurations do not change the search
+    const auto scen_filename = "../assets/random-32-32-10-random-1.scen";
+    const auto map_filename = "../assets/random-32-32-10.map";
+    const auto ins = Instance(scen_filename, map_filename, 200);
+    auto solution_full = solve(ins, 0);
+    HNode::FULL_CONFIG_INTERVAL = 4;
+    auto solution_delta = solve(ins, 0);
+    assert(!solution_full.empty());
+    assert(solution_full == solution_delta);
+
+    // materialization through chains of sparse and dense diffs
+    auto D = DistTable(ins);
+    auto pibt = PIBT(&ins, &D, 0);
+    auto cache = ConfigCache(2);
+    auto nodes = std::vector<HNode *>{new HNode(ins.starts, &D)};
+    auto configs = std::vector<Config>{ins.starts};
+    for (auto t = 0; t < 20; ++t) {
+      auto H = nodes.back();
+      auto Q = cache.get(H);
+      auto activated = (const std::vector<int> *)nullptr;
+      if (t % 3 != 0) {  // otherwise nobody moves -> sparse diff
+        std::fill(Q.begin(), Q.end(), nullptr);
+        const auto res = pibt.set_new_config(cache.get(H), Q,
+                                             H->expansion->order, {},
+                                             H->expansion->num_active);
+        assert(res);
+        activated = &pibt.activated;
+      }
+      nodes.push_back(new HNode(Q, &D, H, 0, 0, activated));
+      configs.push_back(Q);
+      assert(nodes.back()->hash == get_config_hash(Q));
+    }
+    HNode::FULL_CONFIG_INTERVAL = 1;
+    for (auto k = nodes.size(); k-- > 0;) {
+      assert(nodes[k]->get_config() == configs[k]);
+      assert(cache.get(nodes[k]) == configs[k]);
+      assert(nodes[k]->delta_len == (int)k % 4);
+    }
+    for (auto H : nodes) delete H;
+  }
+
+  {
+    // spilled configurations are read back, also as bases of delta chains
+    const auto map_filename = "../assets/random-32-32-10.map";
+    const auto ins = Instance(map_filename, 50, 0);
+    auto D = DistTable(ins);
+    auto pibt = PIBT(&ins, &D, 0);
+    SpillFile::INITIAL_CAPACITY = 1;  // grows with each record
+    auto file = SpillFile(&ins.G, ins.N, ".");
+    SpillFile::INITIAL_CAPACITY = 64 << 20;
+    assert(file.is_open());
+    HNode::FULL_CONFIG_INTERVAL = 3;
+    auto nodes = std::vector<HNode *>{new HNode(ins.starts, &D)};
+    auto configs = std::vector<Config>{ins.starts};
+    for (auto t = 0; t < 10; ++t) {
+      auto H = nodes.back();
+      auto Q = Config(ins.N, nullptr);
+      assert(pibt.set_new_config(configs.back(), Q, H->expansion->order, {},
+                                 H->expansion->num_active));
+      nodes.push_back(new HNode(Q, &D, H, 0, 0, &pibt.activated));
+      configs.push_back(Q);
+    }
+    HNode::FULL_CONFIG_INTERVAL = 1;
+    for (auto H : nodes) {
+      H->release();
+      H->spill(file);
+      assert(H->is_spilled() == (H->delta_len == 0));
+    }
+    assert(file.num_records() == 4);
+    // when the file cannot grow, nodes stay in memory
+    auto H_full = new HNode(ins.starts, &D);
+    H_full->release();
+    file.failed = true;
+    assert(!H_full->spill(file));
+    assert(!H_full->is_spilled() && H_full->get_config() == ins.starts);
+    assert(file.num_records() == 4);
+    delete H_full;
+    auto cache = ConfigCache(2);
+    for (size_t k = 0; k < nodes.size(); ++k) {
+      assert(nodes[k]->get_config() == configs[k]);
+      assert(cache.get(nodes[k]) == configs[k]);
+    }
+    for (auto H : nodes) delete H;
+
+    // the search does not change, anytime until optimality
+    const auto ins_small = Instance("../assets/empty-8-8.map", 2, 0);
+    LaCAM::ANYTIME = true;
+    auto solution = solve(ins_small, 0);
+    LaCAM::SPILL_DIR = ".";
+    assert(solve(ins_small, 0) == solution);
+    LaCAM::SPILL_DIR = "";
+    LaCAM::ANYTIME = false;
+  }
+
+  {
+    // improvements are reported as they happen, with decreasing costs
+    const auto scen_filename = "../assets/random-32-32-10-random-1.scen";
+    const auto map_filename = "../assets/random-32-32-10.map";
+    const auto ins = Instance(scen_filename, map_filename, 100);
+    LaCAM::ANYTIME = true;
+    auto handle = SolutionHandle();
+    auto costs = std::vector<int>();
+    auto consumer = std::async(std::launch::async, [&]() {
+      auto first = Solution();
+      handle.wait(0, 10000);
+      handle.get(first);
+      return first;
+    });
+    const auto deadline = Deadline(500);
+    auto solution =
+        solve(ins, 0, &deadline, 0, nullptr, [&](const Solution &S, int g) {
+          assert(is_feasible_solution(ins, S));
+          costs.push_back(g);
+          handle.update(S, g);
+        });
+    LaCAM::ANYTIME = false;
+    assert(!costs.empty());
+    assert(std::is_sorted(costs.rbegin(), costs.rend()));
+    assert(is_feasible_solution(ins, consumer.get()));
+    auto best = Solution();
+    assert(handle.get(best) == (int)costs.size());
+    assert(handle.get_cost() == costs.back());
+    assert(best == solution);
+  }
+
+  {
+    // checkpoint and resume follow the uninterrupted search exactly
+    const auto ins = Instance("../assets/empty-8-8.map", 2, 0);
+    LaCAM::ANYTIME = true;
+    auto solution = solve(ins, 0);
+    auto D = DistTable(ins);
+    {
+      auto lacam = LaCAM(&ins, &D);
+      lacam.init();
+      assert(lacam.step(5));  // interrupted before the search ends
+      assert(lacam.save_checkpoint("test_checkpoint.bin"));
+    }
+    assert(std::filesystem::exists("test_checkpoint.bin"));
+    LaCAM::RESUME_FILE = "test_checkpoint.bin";
+    {
+      auto resumed = LaCAM(&ins, &D);
+      resumed.init();
+      assert(resumed.loop_cnt == 5);
+      assert(!resumed.OPEN.empty());
+      while (resumed.step(INT_MAX)) {
+      }
+      assert(resumed.result() == solution);
+    }
+    assert(solve(ins, 0) == solution);
+
+    // any corrupted byte is either rejected or leaves a searchable state
+    std::ifstream in("test_checkpoint.bin", std::ios::binary);
+    const auto bytes = std::string(std::istreambuf_iterator<char>(in), {});
+    in.close();
+    LaCAM::RESUME_FILE = "test_corrupted.bin";
+    for (size_t k = 0; k < bytes.size(); ++k) {
+      auto corrupted = bytes;
+      corrupted[k] = ~corrupted[k];
+      std::ofstream("test_corrupted.bin", std::ios::binary) << corrupted;
+      auto lacam = LaCAM(&ins, &D);
+      lacam.init();
+      lacam.step(20);
+    }
+
+    // OPEN is the last section, a node listed twice is rejected
+    {
+      auto n = (uint64_t)0;
+      while (true) {
+        ++n;
+        assert(8 + 4 * n <= bytes.size());
+        uint64_t size;
+        std::memcpy(&size, &bytes[bytes.size() - 8 - 4 * n], 8);
+        if (size == n) break;
+      }
+      auto open_nodes = std::vector<int32_t>(n);
+      const auto offset = bytes.size() - 4 * n;
+      std::memcpy(open_nodes.data(), &bytes[offset], 4 * n);
+      auto k = std::vector<size_t>();
+      for (size_t j = 0; j < n; ++j) {
+        if (open_nodes[j] >= 0) k.push_back(j);
+      }
+      assert(k.size() >= 2);
+      auto corrupted = bytes;
+      std::memcpy(&corrupted[offset + 4 * k[1]], &open_nodes[k[0]], 4);
+      std::ofstream("test_corrupted.bin", std::ios::binary) << corrupted;
+      auto lacam = LaCAM(&ins, &D);
+      assert(!lacam.load_checkpoint("test_corrupted.bin"));
+      assert(lacam.OPEN.empty());
+    }
+    std::remove("test_corrupted.bin");
+    LaCAM::RESUME_FILE = "test_checkpoint.bin";
+
+    // broken or foreign checkpoints are ignored
+    LaCAM::ANYTIME = false;
+    const auto ins_other = Instance("../assets/empty-8-8.map", 2, 1);
+    assert(is_feasible_solution(ins_other, solve(ins_other, 0)));
+    std::filesystem::resize_file("test_checkpoint.bin", 100);
+    assert(is_feasible_solution(ins, solve(ins, 0)));
+    LaCAM::RESUME_FILE = "";
+    std::remove("test_checkpoint.bin");
+  }
+
+  {
+    // interleaved step-wise searches follow their uninterrupted searches
+    const auto ins_a = Instance("../assets/empty-8-8.map", 2, 0);
+    const auto ins_b = Instance("../assets/empty-8-8.map", 2, 1);
+    LaCAM::ANYTIME = true;
+    auto D_a = DistTable(ins_a);
+    auto D_b = DistTable(ins_b);
+    auto lacam_a = LaCAM(&ins_a, &D_a);
+    auto lacam_b = LaCAM(&ins_b, &D_b);
+    lacam_a.init();
+    lacam_b.init();
+    auto running_a = true, running_b = true;
+    while (running_a || running_b) {
+      if (running_a) running_a = lacam_a.step(10);
+      if (running_b) running_b = lacam_b.step(10, 1000);
+      assert(lacam_a.result().empty() || is_feasible_solution(ins_a, lacam_a.result()));
+    }
+    assert(!lacam_a.step(10));
+    assert(lacam_a.result() == solve(ins_a, 0));
+    assert(lacam_b.result() == solve(ins_b, 0));
+    LaCAM::ANYTIME = false;
+  }
+
+  {
+    // cancellation from another thread, the best solution so far is kept
+    const auto ins = Instance("../assets/empty-8-8.map", 3, 2);
+    LaCAM::ANYTIME = true;
+    auto token = CancelToken();
+    const auto deadline = Deadline(60000, &token);
+    auto canceller = std::async(std::launch::async, [&]() {
+      std::this_thread::sleep_for(std::chrono::milliseconds(100));
+      token.cancel();
+    });
+    auto solution = solve(ins, 0, &deadline);
+    canceller.wait();
+    LaCAM::ANYTIME = false;
+    assert(deadline.elapsed_ms() < 10000);
+    assert(is_feasible_solution(ins, solution));
+  }
+
+  {
+    // the first solution is returned early, refined in the background
+    const auto ins = Instance("../assets/empty-8-8.map", 3, 2);
+    const auto deadline = Deadline(300);
+    auto refinement = BackgroundRefinement(ins, 0, &deadline);
+    assert(refinement.lacam.anytime && !LaCAM::ANYTIME);
+    const auto first = refinement.start();
+    assert(is_feasible_solution(ins, first));
+    // the worker may have improved or finished already
+    assert(refinement.handle.get_cost() <= get_sum_of_loss(first));
+    refinement.join();
+    assert(!refinement.is_running());
+    auto best = Solution();
+    refinement.handle.get(best);
+    assert(is_feasible_solution(ins, best));
+    assert(get_sum_of_loss(best) <= get_sum_of_loss(first));
+    assert(best == refinement.lacam.result());
+
+    // stopped before the deadline
+    const auto deadline_long = Deadline(60000);
+    auto refinement_long = BackgroundRefinement(ins, 0, &deadline_long);
+    assert(is_feasible_solution(ins, refinement_long.start()));
+    refinement_long.stop();
+    assert(deadline_long.elapsed_ms() < 10000);
+    assert(!LaCAM::ANYTIME);
+  }
+
+  {
+    // batched expansion, deterministic and eventually optimal
+    const auto scen_filename = "../assets/random-32-32-10-random-1.scen";
+    const auto map_filename = "../assets/random-32-32-10.map";
+    const auto ins = Instance(scen_filename, map_filename, 100);
+    LaCAM::BATCH_SIZE = 4;
+    auto solution = solve(ins, 0);
+    assert(is_feasible_solution(ins, solution));
+    assert(solve(ins, 0) == solution);
+
+    const auto ins_small = Instance("../assets/empty-8-8.map", 2, 0);
+    LaCAM::ANYTIME = true;
+    auto solution_batch = solve(ins_small, 0);
+    LaCAM::BATCH_SIZE = 1;
+    auto solution_seq = solve(ins_small, 0);
+    LaCAM::ANYTIME = false;
+    assert(is_feasible_solution(ins_small, solution_batch));
+    assert(get_sum_of_loss(solution_batch) == get_sum_of_loss(solution_seq));
+  }
+
+  {
+    // agents with distant corridors are solved separately
+    const auto map_filename = "../assets/empty-8-8.map";
+    const auto ins = Instance(map_filename, {0, 63, 7, 56}, {9, 54, 14, 49});
+    auto D = DistTable(ins);
+    auto decomposition = Decomposition(&ins, &D);
+    assert(decomposition.groups.size() == 4);
+    auto grouped = decomposition.solve(0, nullptr, 0);
+    assert(is_feasible_solution(ins, grouped));
+    assert(get_sum_of_loss(grouped) == 8);
+    for (size_t i = 0; i < ins.N; ++i) {
+      assert((int)D.table[i].size() == D.K);  // rows are given back
+    }
+
+    // groups borrow rows of the table, lazy BFS progress is kept
+    auto D_lazy = DistTable(ins, nullptr, false);
+    {
+      const auto sub = Instance(ins, {1, 3});
+      assert(sub.G.V == ins.G.V && sub.goals[1] == ins.goals[3]);
+      auto D_sub = DistTable(D_lazy, {1, 3});
+      assert(D_sub.get(1, sub.starts[1]) == D.get(3, ins.starts[3]));
+    }
+    assert(D_lazy.table[3][ins.starts[3]->id] == D.get(3, ins.starts[3]));
+    Decomposition::ENABLED = true;
+    assert(solve(ins, 0) == grouped);
+
+    // a swap has to step aside onto goals of other groups -> groups collide,
+    // the caller solves all agents jointly
+    Decomposition::MARGIN = 0;
+    const auto ins_collide =
+        Instance(map_filename, {0, 1, 16, 17, 3}, {1, 0, 8, 9, 2});
+    auto D_collide = DistTable(ins_collide);
+    auto decomposition_collide = Decomposition(&ins_collide, &D_collide);
+    assert(decomposition_collide.groups.size() == 4);
+    assert(decomposition_collide.solve(0, nullptr, 0).empty());
+    auto solution = solve(ins_collide, 0);
+    assert(!solution.empty());
+    assert(is_feasible_solution(ins_collide, solution));
+    Decomposition::MARGIN = 1;
+
+    // an agent in the middle joins all groups -> joint search
+    const auto ins_joint =
+        Instance(map_filename, {0, 63, 7, 56, 18}, {9, 54, 14, 49, 45});
+    auto D_joint = DistTable(ins_joint);
+    assert(Decomposition(&ins_joint, &D_joint).groups.size() == 1);
+    assert(is_feasible_solution(ins_joint, solve(ins_joint, 0)));
+    Decomposition::ENABLED = false;
+  }
+
+  {
+    // lazy low-level search enumerates all constraints in BFS order
+    const auto map_filename = "../assets/random-32-32-10.map";
+    const auto ins = Instance(map_filename, 4, 0);
+    auto D = DistTable(ins);
+    auto MT = std::mt19937(0);
+    auto H = HNode(ins.starts, &D);
+    auto expected = 1, width = 1;
+    auto seen = std::set<std::vector<int>>();
+    auto agents = std::vector<int>();
+    auto prev_depth = 0u;
+    for (auto L = H.pop_constraint(ins.starts, MT); L != nullptr;
+         L = H.pop_constraint(ins.starts, MT)) {
+      assert(L->depth >= prev_depth);
+      prev_depth = L->depth;
+      auto Q = Config(ins.N, nullptr);
+      H.get_constraints(L, Q, agents);
+      assert(agents.size() == L->depth);
+      auto key = std::vector<int>();
+      for (size_t d = 0; d < agents.size(); ++d) {
+        const auto i = agents[d];
+        assert(i == H.expansion->order[d]);
+        assert(std::find(ins.starts[i]->actions.begin(),
+                         ins.starts[i]->actions.end(),
+                         Q[i]) != ins.starts[i]->actions.end());
+        key.push_back(Q[i]->id);
+      }
+      assert(seen.insert(key).second);
+    }
+    for (auto i : H.expansion->order) {
+      width *= ins.starts[i]->actions.size();
+      expected += width;
+    }
+    assert(H.expansion->order.size() == ins.N);
+    assert((int)seen.size() == expected);
+
+    // only the cold part remains after the search is exhausted
+    H.release();
+    assert(H.expansion == nullptr);
+    assert(H.pop_constraint(ins.starts, MT) == nullptr);
+  }
+
+  {
+    // OPEN keeps distinct nodes, re-insertion moves them to the front
+    const auto map_filename = "../assets/random-32-32-10.map";
+    const auto ins = Instance(map_filename, 2, 0);
+    auto D = DistTable(ins);
+    auto nodes = std::vector<HNode *>();
+    for (auto k = 0; k < 10; ++k) nodes.push_back(new HNode(ins.starts, &D));
+    auto OPEN = OpenList();
+    auto MT = std::mt19937(0);
+    for (auto H : nodes) OPEN.push_front(H);
+    for (auto k = 0; k < 8; ++k) OPEN.push_front(nodes[k]);
+    assert(OPEN.size() == 10);
+    assert(OPEN.nodes.size() <= 20);  // compacted
+    for (auto t = 0; t < 100; ++t) {
+      auto H = OPEN.get_random(MT);
+      assert(H != nullptr && H->open_index >= 0);
+    }
+    auto popped = std::vector<HNode *>();
+    while (!OPEN.empty()) {
+      popped.push_back(OPEN.front());
+      OPEN.pop_front();
+    }
+    auto expected = std::vector<HNode *>{nodes[7], nodes[6], nodes[5], nodes[4],
+                                         nodes[3], nodes[2], nodes[1], nodes[0],
+                                         nodes[9], nodes[8]};
+    assert(popped == expected);
+    for (auto H : nodes) {
+      assert(H->open_index == -1);
+      delete H;
+    }
+  }
+
+  {
+    // memory budget, the search degrades instead of running out
+    const auto map_filename = "../assets/random-32-32-10.map";
+    const auto ins = Instance(map_filename, 800, 7);
+    auto budget = MemoryBudget();
+    auto solution = solve(ins, 0, nullptr, 0, &budget);
+    assert(!solution.empty());
+    assert(budget.used == 0);  // everything accounted is returned
+    assert(budget.status == MemoryBudget::OK);
+    auto completed_by_rollout = false;
+    for (auto ratio : {0.9, 0.5}) {
+      auto tight = MemoryBudget(budget.peak_mb() * ratio);
+      solution = solve(ins, 0, nullptr, 0, &tight);
+      assert(tight.used == 0);
+      assert(tight.status != MemoryBudget::OK);
+      assert(tight.peak <= tight.limit || tight.status == MemoryBudget::STOPPED);
+      assert(solution.empty() || is_feasible_solution(ins, solution));
+      if (!solution.empty() && tight.status == MemoryBudget::ROLLOUT) {
+        completed_by_rollout = true;
+      }
+    }
+    assert(completed_by_rollout);
+  }
+
+  {
+    // standalone PIBT, online stats agree with the stored solution
+    const auto scen_filename = "../assets/random-32-32-10-random-1.scen";
+    const auto map_filename = "../assets/random-32-32-10.map";
+    const auto ins = Instance(scen_filename, map_filename, 100);
+    auto solution = Solution();
+    const auto stats = solve_pibt(
+        ins, [&](int t, const Config &Q) {
+          assert((int)solution.size() == t);
+          solution.push_back(Q);
+        });
+    assert(stats.solved);
+    assert(is_feasible_solution(ins, solution));
+    assert(stats.makespan == get_makespan(solution));
+    assert(stats.sum_of_costs == get_sum_of_costs(solution));
+    assert(stats.sum_of_loss == get_sum_of_loss(solution));
+  }
+
+  {
+    // regions of the tiled map planned separately, hand-offs at borders
+    const auto scen_filename = "../assets/random-32-32-10-random-1.scen";
+    const auto map_filename = "../assets/random-32-32-10.map";
+    const auto ins = Instance(scen_filename, map_filename, 50);
+    RegionPlanner::TILE_SIZE = 8;
+    RegionPlanner::EPOCH_LENGTH = 8;
+    auto planner = RegionPlanner(&ins);
+    assert(planner.regions.size() >= 16);
+    for (auto v : ins.G.V) {
+      auto &&region = planner.regions[planner.region_of[v->id]];
+      assert(std::binary_search(region.begin(), region.end(), v->id));
+    }
+    auto solution = planner.solve();
+    assert(is_feasible_solution(ins, solution));
+
+    // epochs of at least one step
+    for (auto epoch_length : {0, -1}) {
+      RegionPlanner::EPOCH_LENGTH = epoch_length;
+      auto short_epochs = RegionPlanner(&ins);
+      assert(short_epochs.epoch_length == 1);
+      assert(is_feasible_solution(ins, short_epochs.solve()));
+    }
+
+    // PIBT in each region is sequential, the option is kept
+    PIBT::NUM_THREADS = 2;
+    assert(is_feasible_solution(ins, solve_regions(ins, 0)));
+    assert(PIBT::NUM_THREADS == 2);
+    PIBT::NUM_THREADS = 1;
+    RegionPlanner::TILE_SIZE = 64;
+    RegionPlanner::EPOCH_LENGTH = 32;
+  }
+
+  {
+    // portfolio of processes, the best plan comes through shared memory
+    const auto scen_filename = "../assets/random-32-32-10-random-1.scen";
+    const auto map_filename = "../assets/random-32-32-10.map";
+    const auto ins = Instance(scen_filename, map_filename, 50);
+    Portfolio::NUM_PROCESSES = 2;
+    auto portfolio = Portfolio(&ins);
+    auto solution = portfolio.solve();
+    assert(is_feasible_solution(ins, solution));
+    assert(portfolio.slot->cost == get_sum_of_loss(solution));
+
+    // a process killed while writing does not block the others
+    const auto pid = fork();
+    if (pid == 0) {
+      portfolio.lock();
+      portfolio.slot->writing = true;
+      _exit(0);
+    }
+    waitpid(pid, nullptr, 0);
+    auto partial = Solution();
+    assert(portfolio.read(partial) == -1 && partial.empty());
+    assert(portfolio.publish(solution, 0));
+    assert(portfolio.read(partial) == get_sum_of_loss(solution));
+    assert(partial == solution);
+
+    // anytime processes are stopped at the target, improvements are
+    // reported by the coordinator, memory of children is accounted
+    LaCAM::ANYTIME = true;
+    Portfolio::TARGET_RATIO = 100;
+    const auto deadline = Deadline(60000);
+    auto budget = MemoryBudget(1024);
+    auto costs = std::vector<int>();
+    {
+      auto anytime = Portfolio(&ins, 0, &deadline, 0, &budget,
+                               [&](const Solution &solution, const int cost) {
+                                 assert(is_feasible_solution(ins, solution));
+                                 costs.push_back(cost);
+                               });
+      solution = anytime.solve();
+      assert(is_feasible_solution(ins, solution));
+      assert(anytime.slot->cancel.is_cancelled());
+      assert(budget.peak > anytime.table_bytes);
+    }
+    assert(deadline.elapsed_ms() < 60000);
+    assert(!costs.empty() && costs.back() == get_sum_of_loss(solution));
+    assert(std::is_sorted(costs.rbegin(), costs.rend()));
+    assert(budget.used == 0);
+    LaCAM::ANYTIME = false;
+    Portfolio::TARGET_RATIO = 0;
+
+    // children write no checkpoints, the option is kept for other solvers
+    LaCAM::CHECKPOINT_FILE = "test_portfolio.bin";
+    assert(is_feasible_solution(ins, solve_portfolio(ins, 0)));
+    assert(!std::filesystem::exists("test_portfolio.bin"));
+    assert(LaCAM::CHECKPOINT_FILE == "test_portfolio.bin");
+    LaCAM::CHECKPOINT_FILE = "";
+    Portfolio::NUM_PROCESSES = 4;
+  }
+
+  {
+    // LNS never worsens a solution and keeps it feasible
+    const auto scen_filename = "../assets/random-32-32-20-random-1.scen";
+    const auto map_filename = "../assets/random-32-32-20.map";
+    const auto ins = Instance(scen_filename, map_filename, 100);
+    auto solution = solve(ins);
+    assert(is_feasible_solution(ins, solution));
+    const auto initial = get_sum_of_loss(solution);
+    LNS::NUM_THREADS = 2;
+    LNS::MAX_ROUNDS = 50;
+    auto D = DistTable(ins, nullptr, true);
+    auto lns = LNS(&ins, &D, solution);
+    auto improved = lns.optimize();
+    assert(is_feasible_solution(ins, improved));
+    assert(lns.sum_of_loss == get_sum_of_loss(improved));
+    assert(lns.sum_of_loss < initial);
+    assert(lns.curve.front().second == initial);
+    for (size_t k = 1; k < lns.curve.size(); ++k) {
+      assert(lns.curve[k].second < lns.curve[k - 1].second);
+    }
+
+    // invalid sizes are clamped per instance, the table of solve is reused,
+    // the curve goes to a csv file
+    LNS::NUM_THREADS = 0;
+    LNS::NEIGHBOR_SIZE = 0;
+    auto clamped = LNS(&ins, &D, solution);
+    assert(clamped.num_threads == 1 && clamped.neighbor_size == 1);
+    auto curve = QualityCurve();
+    assert(solve(ins, 0, nullptr, 0, nullptr, nullptr, &D) == solution);
+    improved = optimize_lns(ins, solution, 0, nullptr, 0, &curve, nullptr, &D);
+    assert(is_feasible_solution(ins, improved));
+    assert(curve.back().second == get_sum_of_loss(improved));
+    for (auto k = 0; k < 2; ++k) {
+      make_curve_log(ins, curve, "test_curve.csv", map_filename,
+                     scen_filename, 0);
+    }
+    std::ifstream csv("test_curve.csv");
+    auto lines = std::vector<std::string>();
+    for (std::string line; std::getline(csv, line);) lines.push_back(line);
+    assert(lines.size() == 1 + 2 * curve.size());  // one header
+    assert(lines.front() == "map,scen,agents,seed,elapsed_ms,sum_of_loss");
+    std::remove("test_curve.csv");
+    LNS::NUM_THREADS = 4;
+    LNS::NEIGHBOR_SIZE = 8;
+    LNS::MAX_ROUNDS = INT_MAX;
+  }
+
   return 0;
 }
@@ -66,5 +66,46 @@ int main()
     assert(get_sum_of_costs(sol) == 4);
   }
 
+  // streamed log, same fields in the same order as make_log
+  {
+    const auto map_filename = "../assets/empty-8-8.map";
+    const auto ins = Instance(map_filename, {0, 5, 10}, {2, 4, 11});
+    auto G = &ins.G;
+    auto sol = Solution(3);
+    sol[0] = Config({G->U[0], G->U[5], G->U[10]});
+    sol[1] = Config({G->U[1], G->U[4], G->U[11]});
+    sol[2] = Config({G->U[2], G->U[4], G->U[11]});
+    auto D = DistTable(ins);
+    const auto stats = RolloutStats{true,
+                                    get_makespan(sol),
+                                    get_sum_of_costs(sol),
+                                    get_sum_of_loss(sol),
+                                    get_makespan_lower_bound(ins, D),
+                                    get_sum_of_costs_lower_bound(ins, D)};
+
+    auto streamed = StreamingLog(ins, "test_streamed.txt", map_filename, 0);
+    for (size_t t = 0; t < sol.size(); ++t) streamed.write_config(t, sol[t]);
+    streamed.close(stats, 0, "");
+    make_log(ins, sol, "test_made.txt", 0, map_filename, "", 0);
+    assert(!std::ifstream("test_streamed.txt.paths").good());
+
+    // solver, comp_time and peak_mem_mb differ
+    auto read_lines = [](const std::string &name) {
+      auto lines = std::vector<std::string>();
+      std::ifstream in(name);
+      for (std::string line; std::getline(in, line);) {
+        if (line.rfind("solver=", 0) == 0 || line.rfind("comp_time=", 0) == 0 ||
+            line.rfind("peak_mem_mb=", 0) == 0) {
+          continue;
+        }
+        lines.push_back(line);
+      }
+      return lines;
+    };
+    const auto lines = read_lines("test_streamed.txt");
+    assert(!lines.empty());
+    assert(lines == read_lines("test_made.txt"));
+  }
+
   return 0;
 }